@@ -8,20 +8,16 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(core.pri)
+
 SOURCES += \
     main.cpp \
     mainwindow.cpp \
-    databasemanager.cpp \
-    bookmodel.cpp \
-    readermodel.cpp \
-    borrowmodel.cpp
+    searchcontroller.cpp
 
 HEADERS += \
     mainwindow.h \
-    databasemanager.h \
-    bookmodel.h \
-    readermodel.h \
-    borrowmodel.h
+    searchcontroller.h
 
 FORMS += \
     mainwindow.ui
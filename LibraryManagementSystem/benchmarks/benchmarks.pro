@@ -0,0 +1,11 @@
+QT       += core gui sql testlib
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = modelbenchmark
+
+include(../core.pri)
+
+SOURCES += \
+    modelbenchmark.cpp
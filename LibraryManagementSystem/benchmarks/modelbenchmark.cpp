@@ -0,0 +1,422 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <algorithm>
+#include <cmath>
+#include "databasemanager.h"
+#include "databaseworker.h"
+#include "bookmodel.h"
+#include "borrowmodel.h"
+
+// 模型热点路径的基准测试：在临时SQLite文件中生成不同规模的合成数据，
+// 记录每次操作的耗时，输出吞吐量与p50/p99延迟（JSON）
+//
+// 环境变量：
+//   LIBRARY_BENCH_SIZES  图书数量列表，逗号分隔，默认 10000；百万级规模需显式指定，如 10000,1000000,10000000
+//   LIBRARY_BENCH_JSON   结果文件路径，默认为当前目录下的 benchmark_results.json
+class ModelBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void cleanup();
+
+    void selectBooks_data();
+    void selectBooks();
+    void filterBooks_data();
+    void filterBooks();
+    void borrowBook_data();
+    void borrowBook();
+    void returnBook_data();
+    void returnBook();
+    void getStatistics_data();
+    void getStatistics();
+    void getOverdueRecords_data();
+    void getOverdueRecords();
+
+private:
+    static QList<int> catalogSizes();
+    static void addSizeRows();
+
+    bool openCatalog(int rows);
+    bool generateCatalog(int rows);
+    bool waitForSelect(PagedTableModel* model);
+
+    QTemporaryDir tempDir;
+    int currentRows = 0;
+    BookModel* bookModel = nullptr;
+    BorrowModel* borrowModel = nullptr;
+
+    // 当前数据行的单次耗时（纳秒）
+    QVector<qint64> samples;
+    QJsonArray results;
+};
+
+// 借还书使用的读者和图书：奇数ID的图书没有借出记录，始终有可借副本
+static const char* BenchReaderId = "R00000001";
+static const char* BenchBookIsbn = "9780000000001";
+
+QList<int> ModelBenchmark::catalogSizes()
+{
+    QList<int> sizes;
+    // make check默认只跑小规模，大规模数据生成耗时且占用磁盘
+    QString setting = qEnvironmentVariable("LIBRARY_BENCH_SIZES", "10000");
+    const QStringList parts = setting.split(',', Qt::SkipEmptyParts);
+    for (const QString& part : parts) {
+        bool ok = false;
+        int rows = part.trimmed().toInt(&ok);
+        if (ok && rows >= 100) {
+            sizes << rows;
+        }
+    }
+    return sizes;
+}
+
+void ModelBenchmark::addSizeRows()
+{
+    QTest::addColumn<int>("rows");
+    for (int rows : catalogSizes()) {
+        QTest::newRow(QByteArray::number(rows)) << rows;
+    }
+}
+
+void ModelBenchmark::initTestCase()
+{
+    QVERIFY(tempDir.isValid());
+    QVERIFY(!catalogSizes().isEmpty());
+}
+
+void ModelBenchmark::cleanupTestCase()
+{
+    delete bookModel;
+    delete borrowModel;
+    bookModel = nullptr;
+    borrowModel = nullptr;
+    DatabaseWorker::getInstance().stop();
+    DatabaseManager::getInstance().closeDatabase();
+
+    QString path = qEnvironmentVariable("LIBRARY_BENCH_JSON", "benchmark_results.json");
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        file.write(QJsonDocument(results).toJson());
+        qInfo() << "基准测试结果已写入" << QFileInfo(file).absoluteFilePath();
+    } else {
+        qWarning() << "无法写入基准测试结果:" << path << file.errorString();
+    }
+}
+
+void ModelBenchmark::cleanup()
+{
+    if (samples.isEmpty()) {
+        return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    qint64 total = 0;
+    for (qint64 sample : samples) {
+        total += sample;
+    }
+    // 最近秩法取百分位
+    auto percentile = [this](double p) {
+        int rank = static_cast<int>(std::ceil(p * samples.size()));
+        return samples.at(qBound(0, rank - 1, samples.size() - 1)) / 1e6;
+    };
+
+    QJsonObject result;
+    result["benchmark"] = QString(QTest::currentTestFunction());
+    result["rows"] = currentRows;
+    result["samples"] = samples.size();
+    result["ops_per_sec"] = total > 0 ? samples.size() * 1e9 / total : 0.0;
+    result["p50_ms"] = percentile(0.50);
+    result["p99_ms"] = percentile(0.99);
+    results.append(result);
+
+    qInfo().noquote() << QJsonDocument(result).toJson(QJsonDocument::Compact);
+    samples.clear();
+}
+
+bool ModelBenchmark::openCatalog(int rows)
+{
+    if (rows == currentRows) {
+        return true;
+    }
+
+    // 模型持有旧连接，切换数据库文件前先销毁
+    delete bookModel;
+    delete borrowModel;
+    bookModel = nullptr;
+    borrowModel = nullptr;
+    DatabaseWorker::getInstance().stop();
+    DatabaseManager::getInstance().closeDatabase();
+    currentRows = 0;
+
+    // 同一规模的数据只生成一次，供各项测试共用
+    QString path = tempDir.filePath(QString("catalog_%1.db").arg(rows));
+    bool exists = QFileInfo::exists(path);
+    if (!DatabaseManager::getInstance().initializeDatabase(path)
+        || (!exists && !generateCatalog(rows))
+        || !DatabaseWorker::getInstance().start()) {
+        return false;
+    }
+
+    QSqlDatabase db = DatabaseManager::getInstance().getDatabase();
+    bookModel = new BookModel(nullptr, db);
+    borrowModel = new BorrowModel(nullptr, db);
+    if (!waitForSelect(bookModel) || !waitForSelect(borrowModel)) {
+        return false;
+    }
+    currentRows = rows;
+    return true;
+}
+
+bool ModelBenchmark::generateCatalog(int rows)
+{
+    qInfo() << "生成合成数据:" << rows << "本图书";
+    QElapsedTimer timer;
+    timer.start();
+
+    const int readers = qMax(1, rows / 10);
+    const int loans = rows / 2;
+
+    // 图书：书名由两个常用词和编号组成，便于检索命中不同数量的结果
+    // 读者：图书数量的1/10
+    // 借阅记录：图书数量的1/2，借给偶数ID的图书，三分之一已归还，
+    // 借出日期分布在最近60天内，借期30天，约一半未归还的记录已逾期
+    struct Statement {
+        const char* sql;
+        QVariantList values;
+    };
+    const Statement statements[] = {
+        {R"(
+            WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq WHERE n < ?)
+            INSERT INTO books (isbn, title, author, publisher, publish_date, category,
+                               total_copies, available_copies, price, create_time, update_time)
+            SELECT printf('978%010d', n),
+                   printf('%s %s %d',
+                          CASE n % 8 WHEN 0 THEN 'history' WHEN 1 THEN 'science' WHEN 2 THEN 'river'
+                                     WHEN 3 THEN 'garden' WHEN 4 THEN 'winter' WHEN 5 THEN 'network'
+                                     WHEN 6 THEN 'ocean' ELSE 'mountain' END,
+                          CASE (n / 8) % 8 WHEN 0 THEN 'stories' WHEN 1 THEN 'guide' WHEN 2 THEN 'notes'
+                                           WHEN 3 THEN 'letters' WHEN 4 THEN 'journey' WHEN 5 THEN 'atlas'
+                                           WHEN 6 THEN 'poems' ELSE 'essays' END,
+                          n),
+                   printf('author%d', n % 5000),
+                   printf('publisher%d', n % 200),
+                   date('2000-01-01', printf('+%d days', n % 8000)),
+                   CASE n % 6 WHEN 0 THEN '文学' WHEN 1 THEN '历史' WHEN 2 THEN '科技'
+                              WHEN 3 THEN '艺术' WHEN 4 THEN '教育' ELSE '其他' END,
+                   3, 3, (n % 100) + 0.5, datetime('now'), datetime('now')
+            FROM seq
+        )", QVariantList() << rows},
+        {R"(
+            WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq WHERE n < ?)
+            INSERT INTO readers (reader_id, name, gender, phone, email, address, status)
+            SELECT printf('R%08d', n), printf('reader%d', n), CASE n % 2 WHEN 0 THEN '男' ELSE '女' END,
+                   printf('138%08d', n), printf('reader%d@example.com', n), printf('address %d', n), '正常'
+            FROM seq
+        )", QVariantList() << readers},
+        {R"(
+            WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq WHERE n < ?)
+            INSERT INTO borrow_records (reader_id, book_isbn, borrow_date, due_date, return_date,
+                                        status, fine_amount)
+            SELECT printf('R%08d', n % ? + 1), printf('978%010d', n * 2),
+                   date('now', printf('-%d days', n % 60)),
+                   date('now', printf('-%d days', n % 60), '+30 days'),
+                   CASE n % 3 WHEN 0 THEN date('now') ELSE NULL END,
+                   CASE n % 3 WHEN 0 THEN '已归还' ELSE '借出' END, 0
+            FROM seq
+        )", QVariantList() << loans << readers},
+        {"UPDATE books SET available_copies = 2 WHERE id % 2 = 0 AND id / 2 <= ? AND (id / 2) % 3 != 0",
+         QVariantList() << loans},
+        {"ANALYZE", QVariantList()},
+    };
+
+    QSqlDatabase db = DatabaseManager::getInstance().getDatabase();
+    QSqlQuery query(db);
+    if (!query.exec("BEGIN IMMEDIATE")) {
+        return false;
+    }
+    for (const Statement& statement : statements) {
+        query.prepare(statement.sql);
+        for (const QVariant& value : statement.values) {
+            query.addBindValue(value);
+        }
+        if (!query.exec()) {
+            qWarning() << "生成合成数据失败:" << query.lastError().text();
+            query.finish();
+            db.rollback();
+            return false;
+        }
+        query.finish();
+    }
+    if (!db.commit()) {
+        return false;
+    }
+
+    qInfo() << "合成数据生成完成，耗时" << timer.elapsed() << "毫秒";
+    return true;
+}
+
+bool ModelBenchmark::waitForSelect(PagedTableModel* model)
+{
+    QSignalSpy spy(model, &PagedTableModel::selectFinished);
+    model->select();
+    return spy.wait(600000);
+}
+
+void ModelBenchmark::selectBooks_data()
+{
+    addSizeRows();
+}
+
+void ModelBenchmark::selectBooks()
+{
+    QFETCH(int, rows);
+    QVERIFY(openCatalog(rows));
+    bookModel->setFilter("");
+
+    // 完整的select：统计行数、重置模型并取回首页
+    QBENCHMARK {
+        QElapsedTimer timer;
+        timer.start();
+        QSignalSpy countSpy(bookModel, &PagedTableModel::selectFinished);
+        QSignalSpy pageSpy(bookModel, &QAbstractItemModel::dataChanged);
+        bookModel->select();
+        QVERIFY(countSpy.wait(600000));
+        bookModel->data(bookModel->index(0, 0));
+        QVERIFY(pageSpy.count() > 0 || pageSpy.wait(600000));
+        samples.append(timer.nsecsElapsed());
+    }
+}
+
+void ModelBenchmark::filterBooks_data()
+{
+    addSizeRows();
+}
+
+void ModelBenchmark::filterBooks()
+{
+    QFETCH(int, rows);
+    QVERIFY(openCatalog(rows));
+
+    // 依次使用命中范围不同的关键词：常用词、词组、前缀、几乎无结果
+    static const QStringList keywords = {"river", "ocean guide", "hist", "author42", "nomatch"};
+    int next = 0;
+    QBENCHMARK {
+        const QString& keyword = keywords.at(next++ % keywords.size());
+        QElapsedTimer timer;
+        timer.start();
+        QSignalSpy spy(bookModel, &PagedTableModel::selectFinished);
+        bookModel->filterBooks(keyword, keyword, keyword, "");
+        QVERIFY(spy.wait(600000));
+        samples.append(timer.nsecsElapsed());
+    }
+
+    // 清除全文检索条件（setFilter不会清除MATCH表达式），之后的测试使用完整目录
+    QSignalSpy spy(bookModel, &PagedTableModel::selectFinished);
+    bookModel->filterBooks();
+    QVERIFY(spy.wait(600000));
+}
+
+void ModelBenchmark::borrowBook_data()
+{
+    addSizeRows();
+}
+
+void ModelBenchmark::borrowBook()
+{
+    QFETCH(int, rows);
+    QVERIFY(openCatalog(rows));
+
+    int recordId = 0;
+    QMetaObject::Connection connection = connect(borrowModel, &BorrowModel::loanOpened, this,
+        [&recordId](int id, const QString&, const QString&, const QDate&) { recordId = id; });
+
+    // 只计借书耗时，随后归还以保持可借副本数不变
+    QBENCHMARK {
+        QElapsedTimer timer;
+        timer.start();
+        bool borrowed = borrowModel->borrowBook(BenchReaderId, BenchBookIsbn, 30);
+        samples.append(timer.nsecsElapsed());
+        QVERIFY(borrowed);
+        QVERIFY(borrowModel->returnBook(recordId));
+        QCoreApplication::processEvents();
+    }
+    disconnect(connection);
+}
+
+void ModelBenchmark::returnBook_data()
+{
+    addSizeRows();
+}
+
+void ModelBenchmark::returnBook()
+{
+    QFETCH(int, rows);
+    QVERIFY(openCatalog(rows));
+
+    int recordId = 0;
+    QMetaObject::Connection connection = connect(borrowModel, &BorrowModel::loanOpened, this,
+        [&recordId](int id, const QString&, const QString&, const QDate&) { recordId = id; });
+
+    // 先借出（不计时），只计还书耗时
+    QBENCHMARK {
+        QVERIFY(borrowModel->borrowBook(BenchReaderId, BenchBookIsbn, 30));
+        QElapsedTimer timer;
+        timer.start();
+        bool returned = borrowModel->returnBook(recordId);
+        samples.append(timer.nsecsElapsed());
+        QVERIFY(returned);
+        QCoreApplication::processEvents();
+    }
+    disconnect(connection);
+}
+
+void ModelBenchmark::getStatistics_data()
+{
+    addSizeRows();
+}
+
+void ModelBenchmark::getStatistics()
+{
+    QFETCH(int, rows);
+    QVERIFY(openCatalog(rows));
+
+    QBENCHMARK {
+        QElapsedTimer timer;
+        timer.start();
+        BorrowModel::Statistics stats = borrowModel->getStatistics();
+        samples.append(timer.nsecsElapsed());
+        QVERIFY(stats.totalBorrows >= rows / 2);
+    }
+}
+
+void ModelBenchmark::getOverdueRecords_data()
+{
+    addSizeRows();
+}
+
+void ModelBenchmark::getOverdueRecords()
+{
+    QFETCH(int, rows);
+    QVERIFY(openCatalog(rows));
+
+    QBENCHMARK {
+        QElapsedTimer timer;
+        timer.start();
+        QList<int> overdue = borrowModel->getOverdueRecords();
+        samples.append(timer.nsecsElapsed());
+        QVERIFY(!overdue.isEmpty());
+    }
+}
+
+QTEST_MAIN(ModelBenchmark)
+
+#include "modelbenchmark.moc"
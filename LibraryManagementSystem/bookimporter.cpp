@@ -0,0 +1,378 @@
+#include "bookimporter.h"
+#include "databasemanager.h"
+#include "queryprofiler.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QHash>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QVariantList>
+#include <QSqlQuery>
+#include <QSqlError>
+
+namespace {
+
+// 导入的一条图书记录，字段与books表一致
+struct BookRow {
+    QString isbn;
+    QString title;
+    QString author;
+    QString publisher;
+    QString publishDate;
+    QString category;
+    int totalCopies = 1;
+    double price = 0.0;
+    QString description;
+};
+
+// 解析一行CSV（RFC 4180），引号内的字段可能跨行，此时返回false等待拼接下一行
+bool parseCsvLine(const QString& line, QStringList& fields)
+{
+    fields.clear();
+    QString field;
+    bool quoted = false;
+
+    for (int i = 0; i < line.size(); i++) {
+        QChar c = line.at(i);
+        if (quoted) {
+            if (c == '"') {
+                if (i + 1 < line.size() && line.at(i + 1) == '"') {
+                    field += '"';
+                    i++;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields << field;
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+
+    if (quoted) {
+        return false;
+    }
+    fields << field;
+    return true;
+}
+
+// 取MARC字段中指定子字段的值，如 "10$a三体$c刘慈欣" 中的 $a
+QString marcSubfield(const QString& data, QChar code)
+{
+    int start = data.indexOf(QString('$') + code);
+    if (start < 0) {
+        return QString();
+    }
+    start += 2;
+    int end = data.indexOf('$', start);
+    QString value = data.mid(start, end < 0 ? -1 : end - start).trimmed();
+
+    // 去掉ISBD标点（如书名后的 " /"、出版者后的 " :"）
+    while (!value.isEmpty() && QString(" /:;,=").contains(value.back())) {
+        value.chop(1);
+    }
+    return value;
+}
+
+// 把一个MARC文本字段（"=TAG  指示符$a..."）合并到记录中
+void applyMarcField(const QString& line, BookRow& row, int& holdings)
+{
+    if (line.size() < 5 || line.at(0) != '=') {
+        return;
+    }
+    QString tag = line.mid(1, 3);
+    QString data = line.mid(4).trimmed();
+
+    if (tag == "020") {
+        // ISBN后面可能带有装订说明，如 "9787536692930 (pbk.)"
+        QString isbn = marcSubfield(data, 'a');
+        row.isbn = isbn.section(' ', 0, 0);
+        QString price = marcSubfield(data, 'c');
+        if (!price.isEmpty()) {
+            price.remove(QRegularExpression("[^0-9.]"));
+            row.price = price.toDouble();
+        }
+    } else if (tag == "245") {
+        row.title = marcSubfield(data, 'a');
+        QString subtitle = marcSubfield(data, 'b');
+        if (!subtitle.isEmpty()) {
+            row.title += "：" + subtitle;
+        }
+    } else if (tag == "100" || (tag == "700" && row.author.isEmpty())) {
+        row.author = marcSubfield(data, 'a');
+    } else if (tag == "260" || tag == "264") {
+        row.publisher = marcSubfield(data, 'b');
+        row.publishDate = marcSubfield(data, 'c');
+    } else if (tag == "650" && row.category.isEmpty()) {
+        row.category = marcSubfield(data, 'a');
+    } else if (tag == "520") {
+        row.description = marcSubfield(data, 'a');
+    } else if (tag == "852") {
+        // 每个馆藏字段对应一册
+        holdings++;
+    }
+}
+
+} // namespace
+
+BookImporter::BookImporter(QObject *parent)
+    : QObject(parent)
+{
+}
+
+BookImporter::~BookImporter()
+{
+    if (thread) {
+        cancel();
+        thread->wait();
+    }
+}
+
+bool BookImporter::start(const QString& filePath)
+{
+    if (isRunning()) {
+        return false;
+    }
+
+    cancelRequested = false;
+    QString dbPath = DatabaseManager::getInstance().databasePath();
+
+    thread = QThread::create([this, filePath, dbPath]() {
+        const QString connectionName = "library_import";
+        Summary summary;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+            db.setDatabaseName(dbPath);
+            if (db.open()) {
+                DatabaseManager::getInstance().profile().apply(db);
+                summary = importFile(filePath, db, &cancelRequested, [this](int percent) {
+                    emit progressChanged(percent);
+                });
+                db.close();
+            } else {
+                summary.error = db.lastError().text();
+            }
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+
+        emit finished(summary.imported, summary.skipped, summary.cancelled, summary.error);
+    });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+    return true;
+}
+
+void BookImporter::cancel()
+{
+    cancelRequested = true;
+}
+
+bool BookImporter::isRunning() const
+{
+    return thread && thread->isRunning();
+}
+
+BookImporter::Summary BookImporter::importFile(const QString& filePath, const QSqlDatabase& db,
+                                               const std::atomic_bool* cancelFlag,
+                                               const std::function<void(int)>& progress)
+{
+    Summary summary;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        summary.error = file.errorString();
+        return summary;
+    }
+    const qint64 fileSize = qMax<qint64>(1, file.size());
+    const bool marc = QFileInfo(filePath).suffix().compare("mrk", Qt::CaseInsensitive) == 0;
+
+    // ISBN已存在时更新图书信息，可借册数随总册数的变化同步增减（不小于0）；
+    // SET中引用的books列均为更新前的值
+    QSqlQuery query(db);
+    if (!query.prepare("INSERT INTO books (isbn, title, author, publisher, publish_date, category, "
+                       "total_copies, available_copies, price, description, create_time, update_time) "
+                       "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
+                       "ON CONFLICT(isbn) DO UPDATE SET "
+                       "title = excluded.title, author = excluded.author, "
+                       "publisher = excluded.publisher, publish_date = excluded.publish_date, "
+                       "category = excluded.category, "
+                       "available_copies = MAX(0, books.available_copies + excluded.total_copies - books.total_copies), "
+                       "total_copies = excluded.total_copies, price = excluded.price, "
+                       "description = excluded.description, update_time = excluded.update_time")) {
+        summary.error = query.lastError().text();
+        return summary;
+    }
+
+    QSqlQuery transaction(db);
+    if (!transaction.exec("BEGIN IMMEDIATE")) {
+        summary.error = transaction.lastError().text();
+        return summary;
+    }
+
+    const QString now = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
+    int batchRows = 0;
+    int lastPercent = -1;
+
+    // 写入一条记录，凑满一批时提交并开启下一个事务
+    auto write = [&](const BookRow& row) -> bool {
+        if (row.isbn.isEmpty() || row.title.isEmpty()) {
+            summary.skipped++;
+            return true;
+        }
+
+        query.addBindValue(row.isbn);
+        query.addBindValue(row.title);
+        query.addBindValue(row.author);
+        query.addBindValue(row.publisher);
+        query.addBindValue(row.publishDate);
+        query.addBindValue(row.category);
+        query.addBindValue(row.totalCopies);
+        query.addBindValue(row.totalCopies);
+        query.addBindValue(row.price);
+        query.addBindValue(row.description);
+        query.addBindValue(now);
+        query.addBindValue(now);
+        if (!query.exec()) {
+            summary.error = QString("ISBN %1: %2").arg(row.isbn, query.lastError().text());
+            return false;
+        }
+        summary.imported++;
+
+        if (++batchRows >= BatchSize) {
+            if (!transaction.exec("COMMIT") || !transaction.exec("BEGIN IMMEDIATE")) {
+                summary.error = transaction.lastError().text();
+                return false;
+            }
+            batchRows = 0;
+        }
+        return true;
+    };
+
+    auto report = [&]() {
+        int percent = static_cast<int>(file.pos() * 100 / fileSize);
+        if (progress && percent != lastPercent) {
+            lastPercent = percent;
+            progress(percent);
+        }
+    };
+
+    bool ok = true;
+    if (marc) {
+        // MARC文本格式（MarcEdit .mrk）：每行一个字段，记录之间以空行分隔
+        BookRow row;
+        int holdings = 0;
+        bool hasFields = false;
+        while (ok && !file.atEnd()) {
+            QString line = QString::fromUtf8(file.readLine()).trimmed();
+            if (line.isEmpty()) {
+                if (hasFields) {
+                    row.totalCopies = qMax(1, holdings);
+                    ok = write(row);
+                    row = BookRow();
+                    holdings = 0;
+                    hasFields = false;
+                    report();
+                }
+            } else {
+                applyMarcField(line, row, holdings);
+                hasFields = true;
+            }
+            if (cancelFlag && *cancelFlag) {
+                summary.cancelled = true;
+                break;
+            }
+        }
+        if (ok && hasFields && !summary.cancelled) {
+            row.totalCopies = qMax(1, holdings);
+            ok = write(row);
+        }
+    } else {
+        // CSV：首行为列名（与books表字段同名），列的顺序不限
+        QString pending;
+        QStringList fields;
+        QHash<QString, int> columns;
+        while (ok && !file.atEnd()) {
+            QString line = QString::fromUtf8(file.readLine());
+            if (line.endsWith('\n')) line.chop(1);
+            if (line.endsWith('\r')) line.chop(1);
+
+            pending = pending.isEmpty() ? line : pending + '\n' + line;
+            if (!parseCsvLine(pending, fields)) {
+                continue;
+            }
+            pending.clear();
+
+            if (columns.isEmpty()) {
+                // 去掉UTF-8 BOM
+                if (!fields.isEmpty() && fields[0].startsWith(QChar(0xFEFF))) {
+                    fields[0].remove(0, 1);
+                }
+                for (int i = 0; i < fields.size(); i++) {
+                    columns.insert(fields.at(i).trimmed().toLower(), i);
+                }
+                if (!columns.contains("isbn") || !columns.contains("title")) {
+                    summary.error = "CSV文件缺少isbn或title列";
+                    ok = false;
+                }
+                continue;
+            }
+            if (fields.size() == 1 && fields.at(0).isEmpty()) {
+                continue;
+            }
+
+            auto field = [&](const char* name) {
+                return fields.value(columns.value(name, -1)).trimmed();
+            };
+            BookRow row;
+            row.isbn = field("isbn");
+            row.title = field("title");
+            row.author = field("author");
+            row.publisher = field("publisher");
+            row.publishDate = field("publish_date");
+            row.category = field("category");
+            row.description = field("description");
+            bool copiesOk = false;
+            int copies = field("total_copies").toInt(&copiesOk);
+            row.totalCopies = copiesOk && copies > 0 ? copies : 1;
+            row.price = field("price").toDouble();
+
+            ok = write(row);
+            if ((summary.imported + summary.skipped) % 1000 == 0) {
+                report();
+            }
+            if (cancelFlag && *cancelFlag) {
+                summary.cancelled = true;
+                break;
+            }
+        }
+    }
+
+    // 取消时保留已提交的批次，丢弃当前批次；出错时同样回滚当前批次
+    if (ok && !summary.cancelled) {
+        if (!transaction.exec("COMMIT")) {
+            summary.error = transaction.lastError().text();
+            transaction.exec("ROLLBACK");
+        }
+        if (progress) {
+            progress(100);
+        }
+    } else {
+        summary.imported -= batchRows;
+        transaction.exec("ROLLBACK");
+    }
+
+    if (!summary.error.isEmpty()) {
+        qCWarning(lcModel) << "批量导入失败:" << filePath << summary.error;
+    } else {
+        qCInfo(lcModel) << "批量导入结束:" << filePath << "写入" << summary.imported
+                        << "跳过" << summary.skipped << (summary.cancelled ? "（已取消）" : "");
+    }
+    return summary;
+}
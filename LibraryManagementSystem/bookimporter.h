@@ -0,0 +1,51 @@
+#ifndef BOOKIMPORTER_H
+#define BOOKIMPORTER_H
+
+#include <QObject>
+#include <QThread>
+#include <QSqlDatabase>
+#include <QString>
+#include <QPointer>
+#include <atomic>
+#include <functional>
+
+// 图书批量导入：流式解析CSV或MARC文本格式（.mrk），分批在事务中写入，
+// ISBN重复时更新已有图书
+class BookImporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Summary {
+        qint64 imported = 0;   // 写入（新增或更新）的图书数
+        qint64 skipped = 0;    // 缺少ISBN或书名而跳过的记录数
+        bool cancelled = false;
+        QString error;
+    };
+
+    explicit BookImporter(QObject *parent = nullptr);
+    ~BookImporter();
+
+    // 在后台线程导入文件，进度与结果通过信号返回
+    bool start(const QString& filePath);
+    void cancel();
+    bool isRunning() const;
+
+    // 在当前线程导入文件（命令行模式使用）
+    static Summary importFile(const QString& filePath, const QSqlDatabase& db,
+                              const std::atomic_bool* cancelFlag = nullptr,
+                              const std::function<void(int)>& progress = nullptr);
+
+    // 每个事务写入的行数
+    static const int BatchSize = 10000;
+
+signals:
+    void progressChanged(int percent);
+    void finished(qint64 imported, qint64 skipped, bool cancelled, const QString& error);
+
+private:
+    QPointer<QThread> thread;
+    std::atomic_bool cancelRequested{false};
+};
+
+#endif // BOOKIMPORTER_H
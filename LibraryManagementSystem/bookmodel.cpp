@@ -1,21 +1,37 @@
 #include "bookmodel.h"
 #include <QSqlQuery>
 #include <QSqlError>
-#include <QDebug>
 #include <QDateTime>
+#include <QRegularExpression>
+#include "databasemanager.h"
+#include "lookupcache.h"
+#include "categorydictionary.h"
+#include "borrowmodel.h"
+#include "queryprofiler.h"
+
+// 将关键词转换为FTS5前缀匹配表达式，每个词都需要出现
+static QString ftsPrefixExpression(const QString& keyword)
+{
+    QStringList terms;
+    const QStringList tokens = keyword.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+    for (QString token : tokens) {
+        token.replace("\"", "\"\"");
+        terms << QString("\"%1\"*").arg(token);
+    }
+    return terms.join(" AND ");
+}
 
 BookModel::BookModel(QObject *parent, QSqlDatabase db)
-    : QSqlTableModel(parent, db)
+    : PagedTableModel(parent, db)
 {
     setTable("books");
-    setEditStrategy(QSqlTableModel::OnManualSubmit);
-    setHeaderData(0, Qt::Horizontal, "ID");
-    setHeaderData(1, Qt::Horizontal, "ISBN");
-    setHeaderData(2, Qt::Horizontal, "书名");
-    setHeaderData(3, Qt::Horizontal, "作者");
-    setHeaderData(4, Qt::Horizontal, "出版社");
-    setHeaderData(5, Qt::Horizontal, "出版日期");
-    setHeaderData(6, Qt::Horizontal, "分类");
+    setHeaderData(fieldIndex("id"), Qt::Horizontal, "ID");
+    setHeaderData(fieldIndex("isbn"), Qt::Horizontal, "ISBN");
+    setHeaderData(fieldIndex("title"), Qt::Horizontal, "书名");
+    setHeaderData(fieldIndex("author"), Qt::Horizontal, "作者");
+    setHeaderData(fieldIndex("publisher"), Qt::Horizontal, "出版社");
+    setHeaderData(fieldIndex("publish_date"), Qt::Horizontal, "出版日期");
+    setHeaderData(fieldIndex("category"), Qt::Horizontal, "分类");
     select();
 }
 
@@ -28,23 +44,7 @@ QVariant BookModel::data(const QModelIndex &index, int role) const
         return Qt::AlignCenter;
     }
     
-    return QSqlTableModel::data(index, role);
-}
-
-bool BookModel::setData(const QModelIndex &index, const QVariant &value, int role)
-{
-    if (!index.isValid() || role != Qt::EditRole)
-        return false;
-    
-    return QSqlTableModel::setData(index, value, role);
-}
-
-Qt::ItemFlags BookModel::flags(const QModelIndex &index) const
-{
-    if (!index.isValid())
-        return Qt::NoItemFlags;
-    
-    return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable;
+    return PagedTableModel::data(index, role);
 }
 
 bool BookModel::isbnExists(const QString& isbn)
@@ -53,45 +53,42 @@ bool BookModel::isbnExists(const QString& isbn)
         return false;
     }
     
-    QSqlQuery query(database());
-    query.prepare("SELECT COUNT(*) FROM books WHERE isbn = ?");
+    // 内存索引已加载时直接给出答案
+    LookupCache::Answer cached = LookupCache::getInstance().findBook(isbn.trimmed());
+    if (cached != LookupCache::Unknown) {
+        return cached == LookupCache::Found;
+    }
+    
+    QSqlQuery query = DatabaseManager::getInstance().preparedQuery(
+        "SELECT COUNT(*) FROM books WHERE isbn = ?", database());
     query.addBindValue(isbn.trimmed());
     
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt() > 0;
-    }
-    return false;
+    bool exists = DatabaseManager::getInstance().exec(query) && query.next() && query.value(0).toInt() > 0;
+    query.finish();
+    return exists;
 }
 
 bool BookModel::addBook(const QString& isbn, const QString& title, const QString& author,
                         const QString& publisher, const QString& publishDate, const QString& category,
                         int totalCopies)
 {
-    qDebug() << "=== 开始添加图书 ===";
-    qDebug() << "步骤1: 清理ISBN";
     // 清理ISBN（去除前后空格）
     QString cleanIsbn = isbn.trimmed();
-    qDebug() << "清理后的ISBN:" << cleanIsbn;
     
     // 检查ISBN是否为空
     if (cleanIsbn.isEmpty()) {
-        qDebug() << "添加图书失败: ISBN不能为空";
+        qCWarning(lcModel) << "添加图书失败: ISBN不能为空";
         return false;
     }
     
-    qDebug() << "步骤2: 检查ISBN是否已存在";
     // 检查ISBN是否已存在
     if (isbnExists(cleanIsbn)) {
-        qDebug() << "添加图书失败: ISBN已存在:" << cleanIsbn;
+        qCWarning(lcModel) << "添加图书失败: ISBN已存在:" << cleanIsbn;
         return false;
     }
-    qDebug() << "ISBN检查通过";
     
-    qDebug() << "步骤3: 准备SQL语句";
-    QSqlQuery query(database());
     // 获取当前时间
     QString currentTime = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
-    qDebug() << "当前时间:" << currentTime;
     
     // 使用命名占位符，避免位置占位符在某些环境下出现参数计数异常
     const QString sql =
@@ -99,31 +96,14 @@ bool BookModel::addBook(const QString& isbn, const QString& title, const QString
         "category, total_copies, available_copies, create_time, update_time) "
         "VALUES (:isbn, :title, :author, :publisher, :publish_date, "
         ":category, :total_copies, :available_copies, :create_time, :update_time)";
-    qDebug() << "SQL语句:" << sql;
 
-    qDebug() << "步骤4: 准备查询";
-    if (!query.prepare(sql)) {
-        qDebug() << "添加图书失败: prepare失败:" << query.lastError().text();
-        qDebug() << "错误代码:" << query.lastError().type();
-        qDebug() << "SQL:" << sql;
-        
-        // 检查表结构
-        qDebug() << "步骤4.1: 检查表结构";
-        QSqlQuery checkQuery(database());
-        if (checkQuery.exec("PRAGMA table_info(books)")) {
-            qDebug() << "表结构信息:";
-            while (checkQuery.next()) {
-                qDebug() << "  列名:" << checkQuery.value(1).toString() 
-                         << "类型:" << checkQuery.value(2).toString();
-            }
-        } else {
-            qDebug() << "无法获取表结构信息:" << checkQuery.lastError().text();
-        }
+    bool prepared = false;
+    QSqlQuery query = DatabaseManager::getInstance().preparedQuery(sql, database(), &prepared);
+    if (!prepared) {
+        qCWarning(lcModel) << "添加图书失败: prepare失败:" << query.lastError().text();
         return false;
     }
-    qDebug() << "prepare成功";
 
-    qDebug() << "步骤5: 绑定参数值";
     query.bindValue(":isbn", cleanIsbn);
     query.bindValue(":title", title.trimmed());
     query.bindValue(":author", author.trimmed());
@@ -134,24 +114,21 @@ bool BookModel::addBook(const QString& isbn, const QString& title, const QString
     query.bindValue(":available_copies", totalCopies); // 初始可借册数等于总册数
     query.bindValue(":create_time", currentTime);
     query.bindValue(":update_time", currentTime);
-    qDebug() << "参数绑定完成 - ISBN:" << cleanIsbn 
-             << "书名:" << title.trimmed() 
-             << "总册数:" << totalCopies
-             << "创建时间:" << currentTime;
-    
-    qDebug() << "步骤6: 执行SQL";
-    if (!query.exec()) {
-        QString errorMsg = query.lastError().text();
-        qDebug() << "添加图书失败: exec失败:" << errorMsg;
-        qDebug() << "错误代码:" << query.lastError().type();
-        qDebug() << "执行的SQL:" << query.lastQuery();
+    
+    if (!DatabaseManager::getInstance().exec(query)) {
+        qCWarning(lcModel) << "添加图书失败:" << query.lastError().text();
         return false;
     }
-    qDebug() << "SQL执行成功";
+    qCDebug(lcModel) << "添加图书:" << cleanIsbn << title.trimmed() << "总册数" << totalCopies;
+    
+    LookupCache::BookEntry entry;
+    entry.bookId = query.lastInsertId().toInt();
+    entry.availableCopies = totalCopies;
+    entry.totalCopies = totalCopies;
+    LookupCache::getInstance().putBook(cleanIsbn, entry);
+    CategoryDictionary::getInstance().bookAdded(category.trimmed());
     
-    qDebug() << "步骤7: 刷新模型";
     select();
-    qDebug() << "=== 添加图书完成 ===";
     return true;
 }
 
@@ -159,12 +136,25 @@ bool BookModel::updateBook(int id, const QString& isbn, const QString& title, co
                            const QString& publisher, const QString& publishDate, const QString& category,
                            int totalCopies)
 {
-    QSqlQuery query(database());
     // 获取当前时间作为更新时间
     QString updateTime = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
     
-    query.prepare("UPDATE books SET isbn=?, title=?, author=?, publisher=?, publish_date=?, "
-                  "category=?, total_copies=?, update_time=? WHERE id=?");
+    // ISBN和分类可能被修改，先取出旧值以便更新内存索引和分类字典
+    QSqlQuery oldQuery = DatabaseManager::getInstance().preparedQuery(
+        "SELECT isbn, category FROM books WHERE id=?", database());
+    oldQuery.addBindValue(id);
+    QString oldIsbn;
+    QString oldCategory;
+    if (DatabaseManager::getInstance().exec(oldQuery) && oldQuery.next()) {
+        oldIsbn = oldQuery.value(0).toString();
+        oldCategory = oldQuery.value(1).toString();
+    }
+    oldQuery.finish();
+    
+    QSqlQuery query = DatabaseManager::getInstance().preparedQuery(
+        "UPDATE books SET isbn=?, title=?, author=?, publisher=?, publish_date=?, "
+        "category=?, total_copies=?, update_time=? WHERE id=? "
+        "RETURNING isbn, available_copies, total_copies", database());
     query.addBindValue(isbn.trimmed());
     query.addBindValue(title.trimmed());
     query.addBindValue(author.trimmed());
@@ -175,25 +165,72 @@ bool BookModel::updateBook(int id, const QString& isbn, const QString& title, co
     query.addBindValue(updateTime);
     query.addBindValue(id);
     
-    if (!query.exec()) {
-        qDebug() << "更新图书失败:" << query.lastError().text();
+    if (!DatabaseManager::getInstance().exec(query)) {
+        qCWarning(lcModel) << "更新图书失败:" << query.lastError().text();
         return false;
     }
     
+    if (query.next()) {
+        LookupCache::BookEntry entry;
+        entry.bookId = id;
+        entry.availableCopies = query.value(1).toInt();
+        entry.totalCopies = query.value(2).toInt();
+        if (!oldIsbn.isEmpty()) {
+            LookupCache::getInstance().removeBook(oldIsbn);
+        }
+        LookupCache::getInstance().putBook(query.value(0).toString(), entry);
+        CategoryDictionary::getInstance().bookMoved(oldCategory, category.trimmed());
+    }
+    query.finish();
+    
     select();
     return true;
 }
 
 bool BookModel::deleteBook(int id)
 {
-    QSqlQuery query(database());
-    query.prepare("DELETE FROM books WHERE id=?");
+    QSqlDatabase db = database();
+    DatabaseManager& manager = DatabaseManager::getInstance();
+    
+    // 删除图书与取消其预约在同一事务中完成
+    QSqlQuery beginQuery = manager.preparedQuery("BEGIN IMMEDIATE", db);
+    if (!manager.exec(beginQuery)) {
+        qCWarning(lcModel) << "删除图书失败:" << beginQuery.lastError().text();
+        return false;
+    }
+    
+    QSqlQuery query = manager.preparedQuery("DELETE FROM books WHERE id=? RETURNING isbn, category", db);
     query.addBindValue(id);
     
-    if (!query.exec()) {
-        qDebug() << "删除图书失败:" << query.lastError().text();
+    if (!manager.exec(query)) {
+        qCWarning(lcModel) << "删除图书失败:" << query.lastError().text();
+        db.rollback();
+        return false;
+    }
+    QString isbn;
+    QString category;
+    bool deleted = query.next();
+    if (deleted) {
+        isbn = query.value(0).toString();
+        category = query.value(1).toString();
+    }
+    query.finish();
+    
+    BorrowModel::HoldChanges holdChanges;
+    if (deleted && !BorrowModel::cancelBookHolds(db, isbn, &holdChanges)) {
+        db.rollback();
         return false;
     }
+    if (!db.commit()) {
+        qCWarning(lcModel) << "删除图书失败:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    if (deleted) {
+        LookupCache::getInstance().removeBook(isbn);
+        CategoryDictionary::getInstance().bookRemoved(category);
+    }
+    BorrowModel::applyHoldChanges(holdChanges);
     
     select();
     return true;
@@ -202,50 +239,127 @@ bool BookModel::deleteBook(int id)
 void BookModel::filterBooks(const QString& isbn, const QString& title, 
                             const QString& author, const QString& category)
 {
-    QString filter;
-    if (!isbn.isEmpty()) {
-        filter += QString("isbn LIKE '%%1%'").arg(isbn);
-    }
-    if (!title.isEmpty()) {
-        if (!filter.isEmpty()) filter += " AND ";
-        filter += QString("title LIKE '%%1%'").arg(title);
-    }
-    if (!author.isEmpty()) {
-        if (!filter.isEmpty()) filter += " AND ";
-        filter += QString("author LIKE '%%1%'").arg(author);
+    if (!DatabaseManager::getInstance().isFullTextSearchEnabled()) {
+        // 全文索引不可用时回退为LIKE匹配
+        QString filter;
+        if (!isbn.isEmpty()) {
+            filter += QString("isbn LIKE '%%1%'").arg(isbn);
+        }
+        if (!title.isEmpty()) {
+            if (!filter.isEmpty()) filter += " AND ";
+            filter += QString("title LIKE '%%1%'").arg(title);
+        }
+        if (!author.isEmpty()) {
+            if (!filter.isEmpty()) filter += " AND ";
+            filter += QString("author LIKE '%%1%'").arg(author);
+        }
+        if (!category.isEmpty()) {
+            if (!filter.isEmpty()) filter += " AND ";
+            filter += QString("category LIKE '%%1%'").arg(category);
+        }
+        
+        matchExpression.clear();
+        setFilter(filter);
+        select();
+        return;
     }
-    if (!category.isEmpty()) {
-        if (!filter.isEmpty()) filter += " AND ";
-        filter += QString("category LIKE '%%1%'").arg(category);
+    
+    // 同一个关键词作用于多个列时合并为一个列过滤器（列之间为“或”），不同关键词之间为“与”
+    QList<QPair<QString, QStringList>> groups;
+    auto addTerm = [&groups](const QString& column, const QString& keyword) {
+        QString cleanKeyword = keyword.trimmed();
+        if (cleanKeyword.isEmpty()) {
+            return;
+        }
+        for (auto& group : groups) {
+            if (group.first == cleanKeyword) {
+                group.second << column;
+                return;
+            }
+        }
+        groups.append(qMakePair(cleanKeyword, QStringList() << column));
+    };
+    addTerm("isbn", isbn);
+    addTerm("title", title);
+    addTerm("author", author);
+    addTerm("category", category);
+    
+    QStringList clauses;
+    for (const auto& group : groups) {
+        QString expression = ftsPrefixExpression(group.first);
+        if (!expression.isEmpty()) {
+            clauses << QString("{%1} : (%2)").arg(group.second.join(' '), expression);
+        }
     }
     
-    setFilter(filter);
+    matchExpression = clauses.join(" AND ");
+    setFilter("");
+    select();
+}
+
+void BookModel::filterByCategory(const QString& category)
+{
+    // 按分类ID精确匹配，走category_id索引；字典中没有的分类没有图书
+    matchExpression.clear();
+    setFilter(QString("category_id = %1").arg(CategoryDictionary::getInstance().id(category)));
     select();
 }
 
+QString BookModel::fromClause() const
+{
+    if (matchExpression.isEmpty()) {
+        return PagedTableModel::fromClause();
+    }
+    
+    // 通过全文索引定位匹配的图书
+    QString escaped = matchExpression;
+    escaped.replace("'", "''");
+    return QString("books JOIN (SELECT rowid, rank FROM books_fts WHERE books_fts MATCH '%1') AS m "
+                   "ON books.id = m.rowid").arg(escaped);
+}
+
+QString BookModel::orderClause() const
+{
+    // 全文检索结果按相关度排序
+    return matchExpression.isEmpty() ? QString() : QString("m.rank");
+}
+
 int BookModel::getAvailableCopies(const QString& isbn)
 {
-    QSqlQuery query(database());
-    query.prepare("SELECT available_copies FROM books WHERE isbn=?");
+    LookupCache::BookEntry entry;
+    LookupCache::Answer cached = LookupCache::getInstance().findBook(isbn, &entry);
+    if (cached != LookupCache::Unknown) {
+        return cached == LookupCache::Found ? entry.availableCopies : 0;
+    }
+    
+    QSqlQuery query = DatabaseManager::getInstance().preparedQuery(
+        "SELECT available_copies FROM books WHERE isbn=?", database());
     query.addBindValue(isbn);
     
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt();
+    int copies = 0;
+    if (DatabaseManager::getInstance().exec(query) && query.next()) {
+        copies = query.value(0).toInt();
     }
-    return 0;
+    query.finish();
+    return copies;
 }
 
 bool BookModel::updateCopies(const QString& isbn, int delta)
 {
-    QSqlQuery query(database());
-    query.prepare("UPDATE books SET available_copies = available_copies + ? WHERE isbn=?");
+    QSqlQuery query = DatabaseManager::getInstance().preparedQuery(
+        "UPDATE books SET available_copies = available_copies + ? WHERE isbn=? "
+        "RETURNING available_copies", database());
     query.addBindValue(delta);
     query.addBindValue(isbn);
     
-    if (!query.exec()) {
-        qDebug() << "更新副本数失败:" << query.lastError().text();
+    if (!DatabaseManager::getInstance().exec(query)) {
+        qCWarning(lcModel) << "更新副本数失败:" << query.lastError().text();
         return false;
     }
+    if (query.next()) {
+        LookupCache::getInstance().setAvailableCopies(isbn, query.value(0).toInt());
+    }
+    query.finish();
     
     select();
     return true;
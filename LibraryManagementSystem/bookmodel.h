@@ -1,18 +1,16 @@
 #ifndef BOOKMODEL_H
 #define BOOKMODEL_H
 
-#include <QSqlTableModel>
 #include <QSqlDatabase>
+#include "pagedtablemodel.h"
 
-class BookModel : public QSqlTableModel
+class BookModel : public PagedTableModel
 {
     Q_OBJECT
 
 public:
     explicit BookModel(QObject *parent = nullptr, QSqlDatabase db = QSqlDatabase());
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
-    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
-    Qt::ItemFlags flags(const QModelIndex &index) const override;
     
     // 添加图书
     bool addBook(const QString& isbn, const QString& title, const QString& author,
@@ -34,11 +32,22 @@ public:
     void filterBooks(const QString& isbn = "", const QString& title = "", 
                      const QString& author = "", const QString& category = "");
     
+    // 按分类筛选（分类字典中的名称）
+    void filterByCategory(const QString& category);
+    
     // 获取可用副本数
     int getAvailableCopies(const QString& isbn);
     
     // 更新副本数
     bool updateCopies(const QString& isbn, int delta);
+
+protected:
+    QString fromClause() const override;
+    QString orderClause() const override;
+
+private:
+    // 全文检索的MATCH表达式，为空时按普通筛选条件查询
+    QString matchExpression;
 };
 
 #endif // BOOKMODEL_H
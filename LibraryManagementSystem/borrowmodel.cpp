@@ -1,150 +1,800 @@
 #include "borrowmodel.h"
 #include <QSqlQuery>
 #include <QSqlError>
-#include <QDebug>
 #include <QColor>
+#include <QDateTime>
+#include <utility>
+#include "databasemanager.h"
+#include "lookupcache.h"
+#include "holdqueue.h"
+#include "queryprofiler.h"
 
 BorrowModel::BorrowModel(QObject *parent, QSqlDatabase db)
-    : QSqlTableModel(parent, db)
-{
-    setTable("borrow_records");
-    setEditStrategy(QSqlTableModel::OnManualSubmit);
-    setHeaderData(0, Qt::Horizontal, "ID");
-    setHeaderData(1, Qt::Horizontal, "读者编号");
-    setHeaderData(2, Qt::Horizontal, "图书ISBN");
-    setHeaderData(3, Qt::Horizontal, "借阅日期");
-    setHeaderData(4, Qt::Horizontal, "应还日期");
-    setHeaderData(5, Qt::Horizontal, "归还日期");
-    setHeaderData(6, Qt::Horizontal, "状态");
-    setHeaderData(7, Qt::Horizontal, "罚款金额");
+    : PagedTableModel(parent, db)
+    , statusColumn(-1)
+    , dueDateColumn(-1)
+    , today(0)
+{
+    setupTable("borrow_records");
+    today = QDate::currentDate().toJulianDay();
+    
+    select();
+}
+
+void BorrowModel::setupTable(const QString& tableName)
+{
+    setTable(tableName);
+    setHeaderData(fieldIndex("id"), Qt::Horizontal, "ID");
+    setHeaderData(fieldIndex("reader_id"), Qt::Horizontal, "读者编号");
+    setHeaderData(fieldIndex("book_isbn"), Qt::Horizontal, "图书ISBN");
+    setHeaderData(fieldIndex("borrow_date"), Qt::Horizontal, "借阅日期");
+    setHeaderData(fieldIndex("due_date"), Qt::Horizontal, "应还日期");
+    setHeaderData(fieldIndex("return_date"), Qt::Horizontal, "归还日期");
+    setHeaderData(fieldIndex("status"), Qt::Horizontal, "状态");
+    setHeaderData(fieldIndex("fine_amount"), Qt::Horizontal, "罚款金额");
+    if (fieldIndex("archived_date") >= 0) {
+        setHeaderData(fieldIndex("archived_date"), Qt::Horizontal, "归档日期");
+    }
+    
+    statusColumn = fieldIndex("status");
+    dueDateColumn = fieldIndex("due_date");
+}
+
+void BorrowModel::setArchiveView(bool archived)
+{
+    if (archived == isArchiveView()) {
+        return;
+    }
+    // 筛选条件只用到两表共有的列，切换后保留
+    setupTable(archived ? "borrow_records_archive" : "borrow_records");
     select();
 }
 
+bool BorrowModel::isArchiveView() const
+{
+    return tableName() == "borrow_records_archive";
+}
+
 QVariant BorrowModel::data(const QModelIndex &index, int role) const
 {
     if (!index.isValid())
         return QVariant();
     
-    // 逾期记录高亮显示
-    if (role == Qt::BackgroundRole && index.column() == 6) {
-        QString status = QSqlTableModel::data(index.sibling(index.row(), 6)).toString();
-        if (status == "借出") {
-            QString dueDateStr = QSqlTableModel::data(index.sibling(index.row(), 4)).toString();
-            QDate dueDate = QDate::fromString(dueDateStr, "yyyy-MM-dd");
-            if (dueDate.isValid() && dueDate < QDate::currentDate()) {
-                return QColor(Qt::red).lighter(180);
+    // 逾期记录高亮显示：只比较页读取时记下的应还日期，绘制时不解析日期
+    if (role == Qt::BackgroundRole && index.column() == statusColumn) {
+        auto it = dueDays.constFind(index.row() / pageSize());
+        if (it != dueDays.constEnd()) {
+            int offset = index.row() % pageSize();
+            if (offset < it->size() && it->at(offset) < today) {
+                static const QColor overdueColor = QColor(Qt::red).lighter(180);
+                return overdueColor;
             }
         }
+        return QVariant();
     }
     
     if (role == Qt::TextAlignmentRole) {
         return Qt::AlignCenter;
     }
     
-    return QSqlTableModel::data(index, role);
+    return PagedTableModel::data(index, role);
+}
+
+void BorrowModel::pageLoaded(int page, const QVector<QVariantList>& rows)
+{
+    QVector<qint32> days(rows.size(), NotOverdue);
+    for (int i = 0; i < rows.size(); i++) {
+        const QVariantList& row = rows.at(i);
+        if (row.value(statusColumn).toString() != "借出") {
+            continue;
+        }
+        QDate dueDate = QDate::fromString(row.value(dueDateColumn).toString(), "yyyy-MM-dd");
+        if (dueDate.isValid()) {
+            days[i] = static_cast<qint32>(dueDate.toJulianDay());
+        }
+    }
+    dueDays.insert(page, days);
+}
+
+void BorrowModel::pageEvicted(int page)
+{
+    dueDays.remove(page);
+}
+
+void BorrowModel::markOverdue(const QList<int>& recordIds)
+{
+    // 逾期调度器已经跟踪应还日期，这里只更新当天日期并重绘刚刚逾期的行
+    today = QDate::currentDate().toJulianDay();
+    refreshKeys(recordIds);
 }
 
 bool BorrowModel::borrowBook(const QString& readerId, const QString& bookIsbn, int days)
 {
-    QSqlQuery query(database());
-    
-    // 检查图书是否可借
-    query.prepare("SELECT available_copies FROM books WHERE isbn=?");
-    query.addBindValue(bookIsbn);
-    if (!query.exec() || !query.next()) {
-        qDebug() << "图书不存在或查询失败";
-        return false;
+    return borrowBooks(readerId, QStringList() << bookIsbn, days).constFirst().success;
+}
+
+QVector<BorrowModel::BatchItem> BorrowModel::borrowBooks(const QString& readerId, const QStringList& bookIsbns,
+                                                         int days)
+{
+    QVector<BatchItem> items(bookIsbns.size());
+    for (int i = 0; i < bookIsbns.size(); i++) {
+        items[i].bookIsbn = bookIsbns.at(i);
+    }
+    auto failAll = [&items](const QVector<int>& indexes, const QString& error) {
+        for (int i : indexes) {
+            items[i].success = false;
+            items[i].recordId = 0;
+            items[i].error = error;
+        }
+    };
+    
+    QSqlDatabase db = database();
+    DatabaseManager& manager = DatabaseManager::getInstance();
+    LookupCache& cache = LookupCache::getInstance();
+    
+    // 内存索引能确定读者或图书不存在、副本不够时，不必获取写锁
+    QVector<int> pending;
+    LookupCache::Answer readerAnswer = cache.findReader(readerId);
+    if (readerAnswer == LookupCache::Absent) {
+        qCWarning(lcModel) << "读者不存在:" << readerId;
+        for (int i = 0; i < items.size(); i++) {
+            items[i].error = "读者不存在";
+        }
+        return items;
+    }
+    HoldQueue& holds = HoldQueue::getInstance();
+    if (!holds.isLoaded()) {
+        holds.load(db);
+    }
+    QHash<QString, int> remaining;  // 本批次中各图书尚可借出的副本数（内存索引已知时）
+    QHash<int, int> itemHolds;      // 条目 -> 为该读者保留了副本的预约
+    QHash<int, int> waitingHolds;   // 条目 -> 该读者仍在排队的预约，借到后随之结束
+    QSet<int> usedHolds;
+    for (int i = 0; i < items.size(); i++) {
+        const QString& isbn = items.at(i).bookIsbn;
+        
+        // 预约的书已到：借出为其保留的那一册，不占用可借册数
+        int holdId = holds.activeHold(isbn, readerId);
+        if (holdId > 0 && !usedHolds.contains(holdId)) {
+            usedHolds.insert(holdId);
+            if (holds.hold(holdId).ready) {
+                itemHolds.insert(i, holdId);
+                pending.append(i);
+                continue;
+            }
+            waitingHolds.insert(i, holdId);
+        }
+        
+        auto it = remaining.find(isbn);
+        if (it == remaining.end()) {
+            LookupCache::BookEntry entry;
+            LookupCache::Answer answer = cache.findBook(isbn, &entry);
+            if (answer == LookupCache::Absent) {
+                items[i].error = "图书不存在";
+                continue;
+            }
+            it = remaining.insert(isbn, answer == LookupCache::Found ? entry.availableCopies : -1);
+        }
+        if (it.value() == 0) {
+            items[i].error = "图书已全部借出";
+            continue;
+        }
+        if (it.value() > 0) {
+            it.value()--;
+        }
+        pending.append(i);
+    }
+    if (pending.isEmpty()) {
+        return items;
     }
     
-    int availableCopies = query.value(0).toInt();
-    if (availableCopies <= 0) {
-        qDebug() << "图书已全部借出";
-        return false;
+    // 立即获取写锁：检查、扣减和登记在同一个事务中完成，并发借书不会超借
+    QSqlQuery beginQuery = manager.preparedQuery("BEGIN IMMEDIATE", db);
+    if (!manager.exec(beginQuery)) {
+        qCWarning(lcModel) << "开始借书事务失败:" << beginQuery.lastError().text();
+        failAll(pending, beginQuery.lastError().text());
+        return items;
     }
     
-    // 检查读者是否存在
-    query.prepare("SELECT COUNT(*) FROM readers WHERE reader_id=?");
-    query.addBindValue(readerId);
-    if (!query.exec() || !query.next() || query.value(0).toInt() == 0) {
-        qDebug() << "读者不存在";
-        return false;
+    // 检查读者是否存在（内存索引已确认时跳过）
+    if (readerAnswer != LookupCache::Found) {
+        QSqlQuery readerQuery = manager.preparedQuery("SELECT 1 FROM readers WHERE reader_id=?", db);
+        readerQuery.addBindValue(readerId);
+        bool readerFound = manager.exec(readerQuery) && readerQuery.next();
+        readerQuery.finish();
+        if (!readerFound) {
+            qCWarning(lcModel) << "读者不存在:" << readerId;
+            db.rollback();
+            failAll(pending, "读者不存在");
+            return items;
+        }
     }
     
-    // 插入借阅记录
     QDate borrowDate = QDate::currentDate();
     QDate dueDate = borrowDate.addDays(days);
+    QHash<QString, int> availableCopies;  // 提交后写入内存索引的可借册数
+    bool anyBorrowed = false;
+    
+    for (int i : std::as_const(pending)) {
+        BatchItem& item = items[i];
+        
+        // 兑现已到书的预约；预约已被取消（其他程序）时按普通借书处理
+        auto holdIt = itemHolds.constFind(i);
+        if (holdIt != itemHolds.constEnd()) {
+            QSqlQuery holdQuery = manager.preparedQuery(
+                "UPDATE holds SET status='已借出', closed_date=? WHERE id=? AND status='已到书'", db);
+            holdQuery.addBindValue(borrowDate.toString("yyyy-MM-dd"));
+            holdQuery.addBindValue(holdIt.value());
+            if (!manager.exec(holdQuery)) {
+                qCWarning(lcModel) << "兑现预约失败:" << holdQuery.lastError().text();
+                db.rollback();
+                failAll(pending, holdQuery.lastError().text());
+                return items;
+            }
+            if (holdQuery.numRowsAffected() > 0) {
+                item.holdId = holdIt.value();
+            }
+        }
+        
+        // 条件扣减：只有仍有可借副本时才会更新成功；无法借出的单本跳过，不影响其他图书
+        if (item.holdId == 0) {
+            QSqlQuery copiesQuery = manager.preparedQuery(
+                "UPDATE books SET available_copies = available_copies - 1 "
+                "WHERE isbn=? AND available_copies > 0 RETURNING available_copies", db);
+            copiesQuery.addBindValue(item.bookIsbn);
+            if (!manager.exec(copiesQuery)) {
+                qCWarning(lcModel) << "借书失败:" << copiesQuery.lastError().text();
+                db.rollback();
+                failAll(pending, copiesQuery.lastError().text());
+                return items;
+            }
+            if (!copiesQuery.next()) {
+                copiesQuery.finish();
+                qCWarning(lcModel) << "图书不存在或已全部借出:" << item.bookIsbn;
+                item.error = "图书不存在或已全部借出";
+                continue;
+            }
+            availableCopies.insert(item.bookIsbn, copiesQuery.value(0).toInt());
+            copiesQuery.finish();
+            
+            // 读者借到了正在排队的书，同一事务中结束其预约，否则还书时这一册仍会留给他
+            auto waitingIt = waitingHolds.constFind(i);
+            if (waitingIt != waitingHolds.constEnd()) {
+                QSqlQuery holdQuery = manager.preparedQuery(
+                    "UPDATE holds SET status='已借出', closed_date=? WHERE id=? AND status='等待'", db);
+                holdQuery.addBindValue(borrowDate.toString("yyyy-MM-dd"));
+                holdQuery.addBindValue(waitingIt.value());
+                if (!manager.exec(holdQuery)) {
+                    qCWarning(lcModel) << "结束预约失败:" << holdQuery.lastError().text();
+                    db.rollback();
+                    failAll(pending, holdQuery.lastError().text());
+                    return items;
+                }
+                if (holdQuery.numRowsAffected() > 0) {
+                    item.holdId = waitingIt.value();
+                }
+            }
+        }
+        
+        // 插入借阅记录
+        QSqlQuery query = manager.preparedQuery(
+            "INSERT INTO borrow_records (reader_id, book_isbn, borrow_date, due_date, status) "
+            "VALUES (?, ?, ?, ?, '借出')", db);
+        query.addBindValue(readerId);
+        query.addBindValue(item.bookIsbn);
+        query.addBindValue(borrowDate.toString("yyyy-MM-dd"));
+        query.addBindValue(dueDate.toString("yyyy-MM-dd"));
+        
+        if (!manager.exec(query)) {
+            qCWarning(lcModel) << "借书失败:" << query.lastError().text();
+            db.rollback();
+            failAll(pending, query.lastError().text());
+            return items;
+        }
+        item.recordId = query.lastInsertId().toInt();
+        item.success = true;
+        anyBorrowed = true;
+    }
     
-    query.prepare("INSERT INTO borrow_records (reader_id, book_isbn, borrow_date, due_date, status) "
-                  "VALUES (?, ?, ?, ?, '借出')");
-    query.addBindValue(readerId);
-    query.addBindValue(bookIsbn);
-    query.addBindValue(borrowDate.toString("yyyy-MM-dd"));
-    query.addBindValue(dueDate.toString("yyyy-MM-dd"));
+    if (!anyBorrowed) {
+        db.rollback();
+        return items;
+    }
+    if (!db.commit()) {
+        qCWarning(lcModel) << "提交借书事务失败:" << db.lastError().text();
+        QString error = db.lastError().text();
+        db.rollback();
+        failAll(pending, error);
+        return items;
+    }
+    for (auto it = availableCopies.constBegin(); it != availableCopies.constEnd(); ++it) {
+        cache.setAvailableCopies(it.key(), it.value());
+    }
+    for (const BatchItem& item : std::as_const(items)) {
+        if (item.success && item.holdId > 0) {
+            holds.removed(item.holdId);
+        }
+    }
     
-    if (!query.exec()) {
-        qDebug() << "借书失败:" << query.lastError().text();
-        return false;
+    for (const BatchItem& item : std::as_const(items)) {
+        if (item.success) {
+            emit loanOpened(item.recordId, readerId, item.bookIsbn, dueDate);
+        }
+    }
+    select();
+    return items;
+}
+
+bool BorrowModel::returnBook(int recordId, double* fineAmount, double dailyFine)
+{
+    BatchItem item = returnBooks(QList<int>() << recordId, dailyFine).constFirst();
+    if (item.success && fineAmount) {
+        *fineAmount = item.fine;
+    }
+    return item.success;
+}
+
+QVector<BorrowModel::BatchItem> BorrowModel::returnBooks(const QList<int>& recordIds, double dailyFine)
+{
+    QVector<BatchItem> items(recordIds.size());
+    for (int i = 0; i < recordIds.size(); i++) {
+        items[i].recordId = recordIds.at(i);
     }
+    if (items.isEmpty()) {
+        return items;
+    }
+    auto failAll = [&items](const QString& error) {
+        for (BatchItem& item : items) {
+            item.success = false;
+            item.fine = 0.0;
+            if (item.error.isEmpty()) {
+                item.error = error;
+            }
+        }
+    };
     
-    // 更新图书可借册数
-    query.prepare("UPDATE books SET available_copies = available_copies - 1 WHERE isbn=?");
-    query.addBindValue(bookIsbn);
-    if (!query.exec()) {
-        qDebug() << "更新图书副本数失败";
-        return false;
+    QSqlDatabase db = database();
+    DatabaseManager& manager = DatabaseManager::getInstance();
+    
+    QSqlQuery beginQuery = manager.preparedQuery("BEGIN IMMEDIATE", db);
+    if (!manager.exec(beginQuery)) {
+        qCWarning(lcModel) << "开始还书事务失败:" << beginQuery.lastError().text();
+        failAll(beginQuery.lastError().text());
+        return items;
     }
     
-    select();
-    return true;
+    HoldQueue& holds = HoldQueue::getInstance();
+    if (!holds.isLoaded()) {
+        holds.load(db);
+    }
+    
+    QString returnDate = QDate::currentDate().toString("yyyy-MM-dd");
+    QHash<QString, int> availableCopies;  // 提交后写入内存索引的可借册数
+    QVector<QString> readerIds(items.size());
+    QSet<int> assignedHolds;              // 本批次中已分到副本的预约
+    
+    for (int i = 0; i < items.size(); i++) {
+        BatchItem& item = items[i];
+        
+        // 条件更新：只有未归还的记录会被更新，罚款在同一条语句中按应还日期计算；
+        // 同一批次中重复的记录第二次不会再更新
+        QSqlQuery recordQuery = manager.preparedQuery(
+            "UPDATE borrow_records SET return_date=?, status='已归还', "
+            "fine_amount = MAX(0, CAST(julianday(?) - julianday(due_date) AS INTEGER)) * ? "
+            "WHERE id=? AND status != '已归还' RETURNING book_isbn, fine_amount, reader_id", db);
+        recordQuery.addBindValue(returnDate);
+        recordQuery.addBindValue(returnDate);
+        recordQuery.addBindValue(dailyFine);
+        recordQuery.addBindValue(item.recordId);
+        
+        if (!manager.exec(recordQuery)) {
+            qCWarning(lcModel) << "还书失败:" << recordQuery.lastError().text();
+            db.rollback();
+            failAll(recordQuery.lastError().text());
+            return items;
+        }
+        if (!recordQuery.next()) {
+            recordQuery.finish();
+            qCWarning(lcModel) << "借阅记录不存在或该书已归还:" << item.recordId;
+            item.error = "借阅记录不存在或该书已归还";
+            continue;
+        }
+        item.bookIsbn = recordQuery.value(0).toString();
+        item.fine = recordQuery.value(1).toDouble();
+        readerIds[i] = recordQuery.value(2).toString();
+        recordQuery.finish();
+        
+        // 有人预约时，这一册在同一事务中直接留给等待最久的读者，不计入可借册数
+        int holdId = assignCopyToHold(db, item.bookIsbn, returnDate, assignedHolds, &item.holdReaderId);
+        if (holdId < 0) {
+            db.rollback();
+            failAll("更新预约失败");
+            return items;
+        }
+        if (holdId > 0) {
+            assignedHolds.insert(holdId);
+            item.holdId = holdId;
+            item.success = true;
+            continue;
+        }
+        
+        // 更新图书可借册数
+        QSqlQuery query = manager.preparedQuery(
+            "UPDATE books SET available_copies = available_copies + 1 WHERE isbn=? "
+            "RETURNING available_copies", db);
+        query.addBindValue(item.bookIsbn);
+        if (!manager.exec(query)) {
+            qCWarning(lcModel) << "更新图书副本数失败:" << query.lastError().text();
+            db.rollback();
+            failAll(query.lastError().text());
+            return items;
+        }
+        if (query.next()) {
+            availableCopies.insert(item.bookIsbn, query.value(0).toInt());
+        }
+        query.finish();
+        item.success = true;
+    }
+    
+    if (!db.commit()) {
+        qCWarning(lcModel) << "提交还书事务失败:" << db.lastError().text();
+        QString error = db.lastError().text();
+        db.rollback();
+        failAll(error);
+        return items;
+    }
+    for (auto it = availableCopies.constBegin(); it != availableCopies.constEnd(); ++it) {
+        LookupCache::getInstance().setAvailableCopies(it.key(), it.value());
+    }
+    for (int holdId : std::as_const(assignedHolds)) {
+        holds.markReady(holdId);
+    }
+    
+    bool anyReturned = false;
+    for (int i = 0; i < items.size(); i++) {
+        if (items.at(i).success) {
+            emit loanClosed(items.at(i).recordId, readerIds.at(i), items.at(i).bookIsbn);
+            anyReturned = true;
+        }
+    }
+    if (anyReturned) {
+        select();
+    }
+    return items;
+}
+
+int BorrowModel::assignCopyToHold(const QSqlDatabase& db, const QString& bookIsbn, const QString& readyDate,
+                                  const QSet<int>& taken, QString* readerId)
+{
+    // 在调用方的事务中执行：取该书等待最久的预约并标记为已到书。
+    // 返回预约ID，没有等待的预约时返回0，出错时返回-1
+    HoldQueue& holds = HoldQueue::getInstance();
+    DatabaseManager& manager = DatabaseManager::getInstance();
+    QSet<int> skip = taken;
+    
+    for (;;) {
+        int holdId = holds.nextWaiting(bookIsbn, skip);
+        if (holdId == 0) {
+            return 0;
+        }
+        
+        QSqlQuery query = manager.preparedQuery(
+            "UPDATE holds SET status='已到书', ready_date=? WHERE id=? AND status='等待' RETURNING reader_id", db);
+        query.addBindValue(readyDate);
+        query.addBindValue(holdId);
+        if (!manager.exec(query)) {
+            qCWarning(lcModel) << "分配预约失败:" << query.lastError().text();
+            return -1;
+        }
+        if (query.next()) {
+            *readerId = query.value(0).toString();
+            query.finish();
+            return holdId;
+        }
+        query.finish();
+        
+        // 预约已被其他程序取消，内存中的队列过时，跳过它
+        skip.insert(holdId);
+    }
 }
 
-bool BorrowModel::returnBook(int recordId)
+int BorrowModel::placeHold(const QString& readerId, const QString& bookIsbn, QString* error)
 {
-    QSqlQuery query(database());
+    auto fail = [error](const QString& message) {
+        qCWarning(lcModel) << "预约失败:" << message;
+        if (error) {
+            *error = message;
+        }
+        return 0;
+    };
+    
+    QSqlDatabase db = database();
+    DatabaseManager& manager = DatabaseManager::getInstance();
+    HoldQueue& holds = HoldQueue::getInstance();
+    if (!holds.isLoaded()) {
+        holds.load(db);
+    }
+    if (holds.activeHold(bookIsbn, readerId) > 0) {
+        return fail("该读者已预约此书");
+    }
     
-    // 获取借阅记录信息
-    query.prepare("SELECT book_isbn, status FROM borrow_records WHERE id=?");
-    query.addBindValue(recordId);
-    if (!query.exec() || !query.next()) {
-        qDebug() << "借阅记录不存在";
-        return false;
+    QSqlQuery beginQuery = manager.preparedQuery("BEGIN IMMEDIATE", db);
+    if (!manager.exec(beginQuery)) {
+        return fail(beginQuery.lastError().text());
+    }
+    
+    QSqlQuery readerQuery = manager.preparedQuery("SELECT 1 FROM readers WHERE reader_id=?", db);
+    readerQuery.addBindValue(readerId);
+    bool readerFound = manager.exec(readerQuery) && readerQuery.next();
+    readerQuery.finish();
+    if (!readerFound) {
+        db.rollback();
+        return fail("读者不存在");
     }
     
-    QString bookIsbn = query.value(0).toString();
-    QString status = query.value(1).toString();
+    // 仍有可借副本时直接借书即可，不登记预约
+    QSqlQuery bookQuery = manager.preparedQuery("SELECT available_copies FROM books WHERE isbn=?", db);
+    bookQuery.addBindValue(bookIsbn);
+    if (!manager.exec(bookQuery) || !bookQuery.next()) {
+        bookQuery.finish();
+        db.rollback();
+        return fail("图书不存在");
+    }
+    int available = bookQuery.value(0).toInt();
+    bookQuery.finish();
+    if (available > 0) {
+        db.rollback();
+        return fail("图书尚有可借副本，无需预约");
+    }
+    
+    QDateTime now = QDateTime::currentDateTime();
+    QSqlQuery insertQuery = manager.preparedQuery(
+        "INSERT INTO holds (book_isbn, reader_id, created, status) VALUES (?, ?, ?, '等待')", db);
+    insertQuery.addBindValue(bookIsbn);
+    insertQuery.addBindValue(readerId);
+    insertQuery.addBindValue(now.toString(HoldQueue::TimeFormat));
+    if (!manager.exec(insertQuery)) {
+        QString message = insertQuery.lastError().text();
+        db.rollback();
+        return fail(message);
+    }
+    
+    HoldQueue::Hold hold;
+    hold.id = insertQuery.lastInsertId().toInt();
+    hold.readerId = readerId;
+    hold.bookIsbn = bookIsbn;
+    hold.created = now.toMSecsSinceEpoch();
     
-    if (status == "已归还") {
-        qDebug() << "该书已归还";
+    if (!db.commit()) {
+        QString message = db.lastError().text();
+        db.rollback();
+        return fail(message);
+    }
+    holds.added(hold);
+    return hold.id;
+}
+
+bool BorrowModel::cancelHold(int holdId, QString* error)
+{
+    auto fail = [error](const QString& message) {
+        qCWarning(lcModel) << "取消预约失败:" << message;
+        if (error) {
+            *error = message;
+        }
         return false;
+    };
+    
+    QSqlDatabase db = database();
+    DatabaseManager& manager = DatabaseManager::getInstance();
+    HoldQueue& holds = HoldQueue::getInstance();
+    if (!holds.isLoaded()) {
+        holds.load(db);
+    }
+    
+    QSqlQuery beginQuery = manager.preparedQuery("BEGIN IMMEDIATE", db);
+    if (!manager.exec(beginQuery)) {
+        return fail(beginQuery.lastError().text());
     }
     
-    // 计算罚款
-    double fine = calculateFine(recordId);
+    QSqlQuery statusQuery = manager.preparedQuery("SELECT status, book_isbn FROM holds WHERE id=?", db);
+    statusQuery.addBindValue(holdId);
+    if (!manager.exec(statusQuery) || !statusQuery.next()) {
+        statusQuery.finish();
+        db.rollback();
+        return fail("预约不存在");
+    }
+    QString status = statusQuery.value(0).toString();
+    QString bookIsbn = statusQuery.value(1).toString();
+    statusQuery.finish();
+    if (status != "等待" && status != "已到书") {
+        db.rollback();
+        holds.removed(holdId);
+        return fail("预约已结束");
+    }
     
-    // 更新借阅记录
-    QDate returnDate = QDate::currentDate();
-    query.prepare("UPDATE borrow_records SET return_date=?, status='已归还', fine_amount=? WHERE id=?");
-    query.addBindValue(returnDate.toString("yyyy-MM-dd"));
-    query.addBindValue(fine);
-    query.addBindValue(recordId);
+    QString today = QDate::currentDate().toString("yyyy-MM-dd");
+    QSqlQuery cancelQuery = manager.preparedQuery(
+        "UPDATE holds SET status='已取消', closed_date=? WHERE id=?", db);
+    cancelQuery.addBindValue(today);
+    cancelQuery.addBindValue(holdId);
+    if (!manager.exec(cancelQuery)) {
+        QString message = cancelQuery.lastError().text();
+        db.rollback();
+        return fail(message);
+    }
+    
+    // 已保留的副本转给下一位，没有人等待时恢复可借
+    int nextHoldId = 0;
+    int availableCopies = -1;
+    if (status == "已到书") {
+        QString nextReaderId;
+        nextHoldId = assignCopyToHold(db, bookIsbn, today, QSet<int>() << holdId, &nextReaderId);
+        if (nextHoldId < 0) {
+            db.rollback();
+            return fail("更新预约失败");
+        }
+        if (nextHoldId == 0) {
+            QSqlQuery copiesQuery = manager.preparedQuery(
+                "UPDATE books SET available_copies = available_copies + 1 WHERE isbn=? "
+                "RETURNING available_copies", db);
+            copiesQuery.addBindValue(bookIsbn);
+            if (!manager.exec(copiesQuery)) {
+                QString message = copiesQuery.lastError().text();
+                db.rollback();
+                return fail(message);
+            }
+            if (copiesQuery.next()) {
+                availableCopies = copiesQuery.value(0).toInt();
+            }
+            copiesQuery.finish();
+        } else {
+            qCInfo(lcModel) << "预约取消，保留的副本转给读者:" << nextReaderId << bookIsbn;
+        }
+    }
+    
+    if (!db.commit()) {
+        QString message = db.lastError().text();
+        db.rollback();
+        return fail(message);
+    }
+    holds.removed(holdId);
+    if (nextHoldId > 0) {
+        holds.markReady(nextHoldId);
+    }
+    if (availableCopies >= 0) {
+        LookupCache::getInstance().setAvailableCopies(bookIsbn, availableCopies);
+    }
+    return true;
+}
+
+bool BorrowModel::cancelReaderHolds(const QSqlDatabase& db, const QString& readerId, HoldChanges* changes)
+{
+    DatabaseManager& manager = DatabaseManager::getInstance();
+    HoldQueue& holds = HoldQueue::getInstance();
+    if (!holds.isLoaded()) {
+        holds.load(db);
+    }
     
-    if (!query.exec()) {
-        qDebug() << "还书失败:" << query.lastError().text();
+    // 先记下哪些预约已到书，取消后这些副本需要转给下一位
+    QSqlQuery activeQuery = manager.preparedQuery(
+        "SELECT id, book_isbn, status FROM holds WHERE reader_id=? AND status IN ('等待', '已到书')", db);
+    activeQuery.addBindValue(readerId);
+    if (!manager.exec(activeQuery)) {
+        qCWarning(lcModel) << "读取读者预约失败:" << activeQuery.lastError().text();
         return false;
     }
+    QStringList readyIsbns;
+    while (activeQuery.next()) {
+        changes->cancelled << activeQuery.value(0).toInt();
+        if (activeQuery.value(2).toString() == "已到书") {
+            readyIsbns << activeQuery.value(1).toString();
+        }
+    }
+    activeQuery.finish();
+    if (changes->cancelled.isEmpty()) {
+        return true;
+    }
     
-    // 更新图书可借册数
-    query.prepare("UPDATE books SET available_copies = available_copies + 1 WHERE isbn=?");
-    query.addBindValue(bookIsbn);
-    if (!query.exec()) {
-        qDebug() << "更新图书副本数失败";
+    QString today = QDate::currentDate().toString("yyyy-MM-dd");
+    QSqlQuery cancelQuery = manager.preparedQuery(
+        "UPDATE holds SET status='已取消', closed_date=? WHERE reader_id=? AND status IN ('等待', '已到书')", db);
+    cancelQuery.addBindValue(today);
+    cancelQuery.addBindValue(readerId);
+    if (!manager.exec(cancelQuery)) {
+        qCWarning(lcModel) << "取消读者预约失败:" << cancelQuery.lastError().text();
         return false;
     }
     
-    select();
+    // 内存队列在提交后才更新，本事务中已取消或已接手的预约都要跳过
+    QSet<int> taken(changes->cancelled.constBegin(), changes->cancelled.constEnd());
+    for (const QString& bookIsbn : std::as_const(readyIsbns)) {
+        QString nextReaderId;
+        int nextHoldId = assignCopyToHold(db, bookIsbn, today, taken, &nextReaderId);
+        if (nextHoldId < 0) {
+            return false;
+        }
+        if (nextHoldId > 0) {
+            taken.insert(nextHoldId);
+            changes->readied << nextHoldId;
+            qCInfo(lcModel) << "读者已删除，保留的副本转给读者:" << nextReaderId << bookIsbn;
+            continue;
+        }
+        QSqlQuery copiesQuery = manager.preparedQuery(
+            "UPDATE books SET available_copies = available_copies + 1 WHERE isbn=? "
+            "RETURNING available_copies", db);
+        copiesQuery.addBindValue(bookIsbn);
+        if (!manager.exec(copiesQuery)) {
+            qCWarning(lcModel) << "恢复可借副本失败:" << copiesQuery.lastError().text();
+            return false;
+        }
+        if (copiesQuery.next()) {
+            changes->availableCopies.insert(bookIsbn, copiesQuery.value(0).toInt());
+        }
+        copiesQuery.finish();
+    }
+    return true;
+}
+
+bool BorrowModel::cancelBookHolds(const QSqlDatabase& db, const QString& bookIsbn, HoldChanges* changes)
+{
+    // 图书已删除，保留的副本不再转给其他读者
+    DatabaseManager& manager = DatabaseManager::getInstance();
+    QSqlQuery cancelQuery = manager.preparedQuery(
+        "UPDATE holds SET status='已取消', closed_date=? WHERE book_isbn=? AND status IN ('等待', '已到书') "
+        "RETURNING id", db);
+    cancelQuery.addBindValue(QDate::currentDate().toString("yyyy-MM-dd"));
+    cancelQuery.addBindValue(bookIsbn);
+    if (!manager.exec(cancelQuery)) {
+        qCWarning(lcModel) << "取消图书预约失败:" << cancelQuery.lastError().text();
+        return false;
+    }
+    while (cancelQuery.next()) {
+        changes->cancelled << cancelQuery.value(0).toInt();
+    }
+    cancelQuery.finish();
     return true;
 }
 
+void BorrowModel::applyHoldChanges(const HoldChanges& changes)
+{
+    HoldQueue& holds = HoldQueue::getInstance();
+    for (int holdId : changes.cancelled) {
+        holds.removed(holdId);
+    }
+    for (int holdId : changes.readied) {
+        holds.markReady(holdId);
+    }
+    for (auto it = changes.availableCopies.constBegin(); it != changes.availableCopies.constEnd(); ++it) {
+        LookupCache::getInstance().setAvailableCopies(it.key(), it.value());
+    }
+}
+
+QList<int> BorrowModel::findOpenLoans(const QString& bookIsbn, const QString& readerId)
+{
+    DatabaseManager& manager = DatabaseManager::getInstance();
+    
+    // (book_isbn, status)索引定位该书借出中的记录
+    QString sql = "SELECT id FROM borrow_records WHERE book_isbn=? AND status='借出' ";
+    if (!readerId.isEmpty()) {
+        sql += "AND reader_id=? ";
+    }
+    sql += "ORDER BY due_date, id";
+    QSqlQuery query = manager.preparedQuery(sql, database());
+    query.addBindValue(bookIsbn);
+    if (!readerId.isEmpty()) {
+        query.addBindValue(readerId);
+    }
+    
+    QList<int> recordIds;
+    if (manager.exec(query)) {
+        while (query.next()) {
+            recordIds.append(query.value(0).toInt());
+        }
+    }
+    query.finish();
+    return recordIds;
+}
+
 void BorrowModel::filterRecords(const QString& readerId, const QString& bookIsbn, 
                                 const QString& status)
 {
@@ -168,13 +818,13 @@ void BorrowModel::filterRecords(const QString& readerId, const QString& bookIsbn
 QList<int> BorrowModel::getOverdueRecords()
 {
     QList<int> overdueIds;
-    QSqlQuery query(database());
     QDate today = QDate::currentDate();
     
-    query.prepare("SELECT id FROM borrow_records WHERE status='借出' AND due_date < ?");
+    QSqlQuery query = DatabaseManager::getInstance().preparedQuery(
+        "SELECT id FROM borrow_records WHERE status='借出' AND due_date < ?", database());
     query.addBindValue(today.toString("yyyy-MM-dd"));
     
-    if (query.exec()) {
+    if (DatabaseManager::getInstance().exec(query)) {
         while (query.next()) {
             overdueIds.append(query.value(0).toInt());
         }
@@ -185,15 +835,17 @@ QList<int> BorrowModel::getOverdueRecords()
 
 double BorrowModel::calculateFine(int recordId, double dailyFine)
 {
-    QSqlQuery query(database());
-    query.prepare("SELECT due_date FROM borrow_records WHERE id=?");
+    QSqlQuery query = DatabaseManager::getInstance().preparedQuery(
+        "SELECT due_date FROM borrow_records WHERE id=?", database());
     query.addBindValue(recordId);
     
-    if (!query.exec() || !query.next()) {
+    if (!DatabaseManager::getInstance().exec(query) || !query.next()) {
+        query.finish();
         return 0.0;
     }
     
     QDate dueDate = QDate::fromString(query.value(0).toString(), "yyyy-MM-dd");
+    query.finish();
     QDate returnDate = QDate::currentDate();
     
     if (returnDate <= dueDate) {
@@ -207,33 +859,22 @@ double BorrowModel::calculateFine(int recordId, double dailyFine)
 BorrowModel::Statistics BorrowModel::getStatistics()
 {
     Statistics stats = {0, 0, 0, 0};
-    QSqlQuery query(database());
-    
-    // 总借阅数
-    query.exec("SELECT COUNT(*) FROM borrow_records");
-    if (query.next()) {
-        stats.totalBorrows = query.value(0).toInt();
-    }
-    
-    // 当前借出数
-    query.exec("SELECT COUNT(*) FROM borrow_records WHERE status='借出'");
-    if (query.next()) {
-        stats.currentBorrows = query.value(0).toInt();
-    }
-    
-    // 逾期数
-    QDate today = QDate::currentDate();
-    query.prepare("SELECT COUNT(*) FROM borrow_records WHERE status='借出' AND due_date < ?");
-    query.addBindValue(today.toString("yyyy-MM-dd"));
-    if (query.exec() && query.next()) {
+    DatabaseManager& manager = DatabaseManager::getInstance();
+    
+    // 借阅、归还数量来自触发器维护的计数表
+    QHash<QString, qint64> counters = manager.readCounters(database());
+    stats.totalBorrows = static_cast<int>(counters.value("total_borrows"));
+    stats.currentBorrows = static_cast<int>(counters.value("current_borrows"));
+    stats.totalReturns = static_cast<int>(counters.value("total_returns"));
+    
+    // 逾期数随日期变化，无法由触发器维护；按(status, due_date)索引只扫描逾期部分
+    QSqlQuery query = manager.preparedQuery(
+        "SELECT COUNT(*) FROM borrow_records WHERE status='借出' AND due_date < ?", database());
+    query.addBindValue(QDate::currentDate().toString("yyyy-MM-dd"));
+    if (manager.exec(query) && query.next()) {
         stats.overdueCount = query.value(0).toInt();
     }
-    
-    // 已归还数
-    query.exec("SELECT COUNT(*) FROM borrow_records WHERE status='已归还'");
-    if (query.next()) {
-        stats.totalReturns = query.value(0).toInt();
-    }
+    query.finish();
     
     return stats;
 }
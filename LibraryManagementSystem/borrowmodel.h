@@ -1,11 +1,15 @@
 #ifndef BORROWMODEL_H
 #define BORROWMODEL_H
 
-#include <QSqlTableModel>
 #include <QSqlDatabase>
 #include <QDate>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QStringList>
+#include "pagedtablemodel.h"
 
-class BorrowModel : public QSqlTableModel
+class BorrowModel : public PagedTableModel
 {
     Q_OBJECT
 
@@ -13,11 +17,55 @@ public:
     explicit BorrowModel(QObject *parent = nullptr, QSqlDatabase db = QSqlDatabase());
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     
+    // 批量借还中每本书的结果
+    struct BatchItem {
+        QString bookIsbn;
+        int recordId = 0;
+        bool success = false;
+        double fine = 0.0;
+        QString error;
+        int holdId = 0;        // 借书时随之结束的预约，或还书时这一册被保留给的预约
+        QString holdReaderId;  // 还书时这一册应留给的读者
+    };
+    
     // 借书
     bool borrowBook(const QString& readerId, const QString& bookIsbn, int days = 30);
     
-    // 还书
-    bool returnBook(int recordId);
+    // 同一读者一次借多本：先按内存索引剔除不存在或已无副本的图书，其余在一个事务中登记，
+    // 无法借出的单本跳过；结果与bookIsbns一一对应，提交后只刷新一次
+    QVector<BatchItem> borrowBooks(const QString& readerId, const QStringList& bookIsbns, int days = 30);
+    
+    // 还书，fineAmount返回本次计算的逾期罚款
+    bool returnBook(int recordId, double* fineAmount = nullptr, double dailyFine = 0.5);
+    
+    // 一次归还多条借阅记录，在一个事务中完成；结果与recordIds一一对应
+    QVector<BatchItem> returnBooks(const QList<int>& recordIds, double dailyFine = 0.5);
+    
+    // 预约：图书已无可借副本时登记，归还时按预约先后把副本留给等待的读者；
+    // 返回预约ID，失败时返回0
+    int placeHold(const QString& readerId, const QString& bookIsbn, QString* error = nullptr);
+    
+    // 取消预约；已为其保留的副本转给下一位等待的读者，没有时恢复可借
+    bool cancelHold(int holdId, QString* error = nullptr);
+    
+    // 删除读者或图书时在调用方的事务中取消其全部有效预约：读者已到书的副本转给下一位等待的读者，
+    // 没有人等待时恢复可借；图书的预约直接取消。提交后用applyHoldChanges同步内存
+    struct HoldChanges {
+        QList<int> cancelled;                  // 已取消的预约
+        QList<int> readied;                    // 接手保留副本的预约
+        QHash<QString, int> availableCopies;   // 副本恢复可借后的册数
+    };
+    static bool cancelReaderHolds(const QSqlDatabase& db, const QString& readerId, HoldChanges* changes);
+    static bool cancelBookHolds(const QSqlDatabase& db, const QString& bookIsbn, HoldChanges* changes);
+    static void applyHoldChanges(const HoldChanges& changes);
+    
+    // 该书借出中的记录（readerId不为空时只找该读者的），按应还日期排列
+    QList<int> findOpenLoans(const QString& bookIsbn, const QString& readerId = QString());
+    
+    // 切换到已归档的记录（borrow_records_archive，只供查阅），或切回当前的借阅记录；
+    // 归档表只在切换后才查询
+    void setArchiveView(bool archived);
+    bool isArchiveView() const;
     
     // 多条件筛选
     void filterRecords(const QString& readerId = "", const QString& bookIsbn = "", 
@@ -26,6 +74,7 @@ public:
     // 获取逾期记录
     QList<int> getOverdueRecords();
     
+    
     // 计算逾期罚款
     double calculateFine(int recordId, double dailyFine = 0.5);
     
@@ -37,6 +86,34 @@ public:
         int totalReturns;
     };
     Statistics getStatistics();
+
+public slots:
+    // 逾期调度器报告新增的逾期记录时更新当天日期，并重绘这些行
+    void markOverdue(const QList<int>& recordIds);
+
+signals:
+    // 借书登记成功
+    void loanOpened(int recordId, const QString& readerId, const QString& bookIsbn, const QDate& dueDate);
+    
+    // 还书成功
+    void loanClosed(int recordId, const QString& readerId, const QString& bookIsbn);
+
+protected:
+    void pageLoaded(int page, const QVector<QVariantList>& rows) override;
+    void pageEvicted(int page) override;
+
+private:
+    void setupTable(const QString& tableName);
+    static int assignCopyToHold(const QSqlDatabase& db, const QString& bookIsbn, const QString& readyDate,
+                                const QSet<int>& taken, QString* readerId);
+
+    int statusColumn;
+    int dueDateColumn;
+
+    // 每页每行的应还日期（儒略日），只在页读取时解析一次；已归还或日期无效的行为NotOverdue
+    static constexpr qint32 NotOverdue = 0x7fffffff;
+    QHash<int, QVector<qint32>> dueDays;
+    qint64 today;
 };
 
 #endif // BORROWMODEL_H
@@ -0,0 +1,106 @@
+#include "categorydictionary.h"
+#include "databasemanager.h"
+#include "queryprofiler.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <algorithm>
+
+CategoryDictionary& CategoryDictionary::getInstance()
+{
+    static CategoryDictionary instance;
+    return instance;
+}
+
+bool CategoryDictionary::load(const QSqlDatabase& db)
+{
+    entries.clear();
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT id, name, book_count FROM categories")) {
+        qCWarning(lcModel) << "读取分类字典失败:" << query.lastError().text();
+        emit reset();
+        return false;
+    }
+    while (query.next()) {
+        Entry entry;
+        entry.id = query.value(0).toInt();
+        entry.count = query.value(2).toInt();
+        entries.insert(query.value(1).toString(), entry);
+    }
+
+    emit reset();
+    return true;
+}
+
+void CategoryDictionary::clear()
+{
+    entries.clear();
+    emit reset();
+}
+
+QStringList CategoryDictionary::names() const
+{
+    QStringList result;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        if (it->count > 0) {
+            result << it.key();
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+bool CategoryDictionary::contains(const QString& name) const
+{
+    auto it = entries.constFind(name);
+    return it != entries.constEnd() && it->count > 0;
+}
+
+int CategoryDictionary::id(const QString& name) const
+{
+    return entries.value(name).id;
+}
+
+void CategoryDictionary::bookAdded(const QString& name)
+{
+    if (name.isEmpty()) {
+        return;
+    }
+
+    Entry& entry = entries[name];
+    if (entry.id == 0) {
+        // 新分类的行由插入图书的触发器创建，这里只需取回ID
+        DatabaseManager& manager = DatabaseManager::getInstance();
+        QSqlQuery query = manager.preparedQuery("SELECT id FROM categories WHERE name=?", manager.getDatabase());
+        query.addBindValue(name);
+        if (manager.exec(query) && query.next()) {
+            entry.id = query.value(0).toInt();
+        }
+        query.finish();
+    }
+
+    if (++entry.count == 1) {
+        emit categoryAdded(name);
+    }
+}
+
+void CategoryDictionary::bookRemoved(const QString& name)
+{
+    auto it = entries.find(name);
+    if (name.isEmpty() || it == entries.end() || it->count <= 0) {
+        return;
+    }
+    if (--it->count == 0) {
+        emit categoryRemoved(name);
+    }
+}
+
+void CategoryDictionary::bookMoved(const QString& oldName, const QString& newName)
+{
+    if (oldName == newName) {
+        return;
+    }
+    bookAdded(newName);
+    bookRemoved(oldName);
+}
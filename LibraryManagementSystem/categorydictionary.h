@@ -0,0 +1,56 @@
+#ifndef CATEGORYDICTIONARY_H
+#define CATEGORYDICTIONARY_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSqlDatabase>
+
+// 图书分类字典：categories表中每个分类的ID与图书数量的内存副本。
+// 启动时加载一次，之后由图书的增删改同步增减引用计数（与表中触发器维护的book_count一致），
+// 分类第一次出现或最后一本书被删除时发出增量信号，下拉框不再整表重建。
+// 只在界面线程（写连接所属线程）使用；批量导入等独立连接写入后需要重新加载
+class CategoryDictionary : public QObject
+{
+    Q_OBJECT
+
+public:
+    static CategoryDictionary& getInstance();
+
+    // 读取全部分类及其图书数量，完成后发出reset
+    bool load(const QSqlDatabase& db);
+    void clear();
+
+    // 有图书的分类，按名称排序
+    QStringList names() const;
+    bool contains(const QString& name) const;
+
+    // 分类ID（books.category_id），未知的分类返回0
+    int id(const QString& name) const;
+
+    // 图书增删改后调整引用计数；空分类忽略
+    void bookAdded(const QString& name);
+    void bookRemoved(const QString& name);
+    void bookMoved(const QString& oldName, const QString& newName);
+
+signals:
+    void categoryAdded(const QString& name);
+    void categoryRemoved(const QString& name);
+    void reset();
+
+private:
+    CategoryDictionary() = default;
+    CategoryDictionary(const CategoryDictionary&) = delete;
+    CategoryDictionary& operator=(const CategoryDictionary&) = delete;
+
+    struct Entry {
+        int id = 0;
+        int count = 0;
+    };
+
+    // 计数归零的分类保留ID（表中的行不删除），再次出现时无需查询
+    QHash<QString, Entry> entries;
+};
+
+#endif // CATEGORYDICTIONARY_H
@@ -0,0 +1,50 @@
+#ifndef CIRCULATIONCLI_H
+#define CIRCULATIONCLI_H
+
+#include <QStringList>
+#include <QString>
+#include <QTextStream>
+
+// 无界面的命令行模式：供定时任务、批量处理和压力测试使用，
+// 与图形界面共用DatabaseManager和各个模型
+//
+//   LibraryManagementSystem <命令> [参数] --db 数据库文件 [--config 配置文件] [--pragma key=value]
+class CirculationCli
+{
+public:
+    // 第一个参数是否为命令行子命令（决定是否创建图形界面）
+    static bool isCommand(int argc, char *argv[]);
+
+    // 数据库文件：--db 指定，未指定时返回defaultPath（命令行模式为空，界面模式为默认路径）
+    static QString databasePath(const QStringList& arguments, const QString& defaultPath = QString());
+
+    // 执行子命令，返回进程退出码
+    static int run(const QStringList& arguments);
+
+private:
+    explicit CirculationCli(const QStringList& arguments);
+
+    int exec();
+    int importBooks();
+    int exportTable();
+    int borrowBatch();
+    int returnBatch();
+    int overdueSweep();
+    int stats();
+    int archiveLoans();
+    int backupSnapshot();
+    int restoreSnapshot();
+    int usage(int exitCode);
+
+    // 去掉全局选项后的位置参数，以及是否带有某个开关
+    QString positional(int index) const;
+    bool hasFlag(const QString& flag) const;
+    QString optionValue(const QString& option, const QString& defaultValue = QString()) const;
+
+    QStringList arguments;
+    QStringList positionals;
+    QTextStream out;
+    QTextStream err;
+};
+
+#endif // CIRCULATIONCLI_H
@@ -0,0 +1,45 @@
+# 与界面无关的数据库与模型代码，主程序和基准测试共用
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/databasemanager.cpp \
+    $$PWD/databaseworker.cpp \
+    $$PWD/pagedtablemodel.cpp \
+    $$PWD/sqliteprofile.cpp \
+    $$PWD/schemadescriptor.cpp \
+    $$PWD/overduescheduler.cpp \
+    $$PWD/bookimporter.cpp \
+    $$PWD/dataexporter.cpp \
+    $$PWD/databasebackup.cpp \
+    $$PWD/loanarchiver.cpp \
+    $$PWD/bookmodel.cpp \
+    $$PWD/readermodel.cpp \
+    $$PWD/readerloansmodel.cpp \
+    $$PWD/borrowmodel.cpp \
+    $$PWD/lookupcache.cpp \
+    $$PWD/categorydictionary.cpp \
+    $$PWD/holdqueue.cpp \
+    $$PWD/queryprofiler.cpp \
+    $$PWD/circulationcli.cpp
+
+HEADERS += \
+    $$PWD/databasemanager.h \
+    $$PWD/databaseworker.h \
+    $$PWD/pagedtablemodel.h \
+    $$PWD/sqliteprofile.h \
+    $$PWD/schemadescriptor.h \
+    $$PWD/overduescheduler.h \
+    $$PWD/bookimporter.h \
+    $$PWD/dataexporter.h \
+    $$PWD/databasebackup.h \
+    $$PWD/loanarchiver.h \
+    $$PWD/bookmodel.h \
+    $$PWD/readermodel.h \
+    $$PWD/readerloansmodel.h \
+    $$PWD/borrowmodel.h \
+    $$PWD/lookupcache.h \
+    $$PWD/categorydictionary.h \
+    $$PWD/holdqueue.h \
+    $$PWD/queryprofiler.h \
+    $$PWD/circulationcli.h
@@ -0,0 +1,376 @@
+#include "databasebackup.h"
+#include "databasemanager.h"
+#include "queryprofiler.h"
+#include <QCoreApplication>
+#include <QSettings>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+namespace {
+
+// 快照中必须存在的表
+const QStringList RequiredTables = {"books", "readers", "borrow_records"};
+
+// 数据库文件名中的时间部分
+const char* SnapshotTimeFormat = "yyyyMMdd-HHmmss";
+
+// 启动时需要补做快照的延迟，避开启动时的加载查询
+const int CatchUpDelayMs = 60 * 1000;
+
+QString pendingRestore;
+
+} // namespace
+
+DatabaseBackup::Schedule DatabaseBackup::Schedule::load(const QStringList& arguments)
+{
+    Schedule schedule;
+
+    QString configFile = QCoreApplication::applicationDirPath() + "/library.ini";
+    for (int i = 0; i < arguments.size(); i++) {
+        const QString& arg = arguments.at(i);
+        if (arg == "--config" && i + 1 < arguments.size()) {
+            configFile = arguments.at(i + 1);
+        } else if (arg.startsWith("--config=")) {
+            configFile = arg.mid(QString("--config=").length());
+        }
+    }
+
+    if (QFileInfo::exists(configFile)) {
+        QSettings settings(configFile, QSettings::IniFormat);
+        settings.beginGroup("backup");
+        schedule.directory = settings.value("directory").toString();
+        schedule.intervalHours = qMax(0, settings.value("interval_hours", schedule.intervalHours).toInt());
+        schedule.keep = qMax(0, settings.value("keep", schedule.keep).toInt());
+        settings.endGroup();
+    }
+    return schedule;
+}
+
+DatabaseBackup::DatabaseBackup(QObject *parent)
+    : QObject(parent)
+{
+    connect(&timer, &QTimer::timeout, this, &DatabaseBackup::onTimeout);
+}
+
+DatabaseBackup::~DatabaseBackup()
+{
+    timer.stop();
+    if (thread) {
+        thread->wait();
+    }
+}
+
+void DatabaseBackup::setSchedule(const Schedule& schedule)
+{
+    currentSchedule = schedule;
+    timer.stop();
+    if (schedule.intervalHours <= 0) {
+        return;
+    }
+
+    // 间隔最长24天，避免毫秒数溢出
+    qint64 intervalMs = qMin<qint64>(qint64(schedule.intervalHours) * 3600 * 1000, 24LL * 24 * 3600 * 1000);
+    timer.setInterval(int(intervalMs));
+
+    // 上次快照已超过间隔（或还没有快照）时先补做一次，之后按间隔执行
+    QString dbPath = DatabaseManager::getInstance().databasePath();
+    QStringList existing = snapshots(snapshotDirectory(schedule, dbPath), dbPath);
+    qint64 sinceLast = intervalMs;
+    if (!existing.isEmpty()) {
+        sinceLast = QFileInfo(existing.first()).lastModified().msecsTo(QDateTime::currentDateTime());
+    }
+    if (sinceLast >= intervalMs) {
+        timer.start(CatchUpDelayMs);
+    } else {
+        timer.start(int(intervalMs - sinceLast));
+    }
+}
+
+DatabaseBackup::Schedule DatabaseBackup::schedule() const
+{
+    return currentSchedule;
+}
+
+void DatabaseBackup::onTimeout()
+{
+    // 补做或首次触发后恢复正常间隔
+    qint64 intervalMs = qMin<qint64>(qint64(currentSchedule.intervalHours) * 3600 * 1000, 24LL * 24 * 3600 * 1000);
+    timer.setInterval(int(intervalMs));
+    if (!isRunning()) {
+        start();
+    }
+}
+
+bool DatabaseBackup::start(const QString& targetPath)
+{
+    QString dbPath = DatabaseManager::getInstance().databasePath();
+    if (isRunning() || dbPath.isEmpty()) {
+        return false;
+    }
+
+    Schedule schedule = currentSchedule;
+    QString directory = snapshotDirectory(schedule, dbPath);
+    QString target = targetPath.isEmpty() ? newSnapshotPath(directory, dbPath) : targetPath;
+
+    thread = QThread::create([this, dbPath, target, directory, schedule, targetPath]() {
+        Summary summary = createSnapshot(dbPath, target);
+        // 只有写入快照目录的定时或默认快照参与轮换，另存到其他位置的不清理
+        if (summary.error.isEmpty() && targetPath.isEmpty()) {
+            prune(directory, dbPath, schedule.keep);
+        }
+        emit finished(summary.path, summary.error);
+    });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+    return true;
+}
+
+bool DatabaseBackup::isRunning() const
+{
+    return thread && thread->isRunning();
+}
+
+DatabaseBackup::Summary DatabaseBackup::createSnapshot(const QString& dbPath, const QString& targetPath)
+{
+    Summary summary;
+    summary.path = targetPath;
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    QFileInfo targetInfo(targetPath);
+    if (targetInfo.absoluteFilePath() == QFileInfo(dbPath).absoluteFilePath()) {
+        summary.error = "快照文件不能是数据库本身";
+        return summary;
+    }
+    if (!QDir().mkpath(targetInfo.absolutePath())) {
+        summary.error = QString("无法创建目录: %1").arg(targetInfo.absolutePath());
+        return summary;
+    }
+
+    // 先写入临时文件，VACUUM INTO要求目标文件不存在
+    QString partPath = targetPath + ".part";
+    QFile::remove(partPath);
+
+    // 独立连接：读连接池中的连接是只读的（query_only），不能执行VACUUM
+    const QString connectionName = QString("library_backup_%1").arg(quintptr(QThread::currentThreadId()));
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(dbPath);
+        if (!db.open()) {
+            summary.error = db.lastError().text();
+        } else {
+            DatabaseManager::getInstance().profile().apply(db);
+            // 快照内容是一个读事务看到的数据库，写连接在此期间照常提交（WAL）；
+            // 生成的文件是紧凑的、不依赖-wal文件的单个数据库文件
+            QSqlQuery query(db);
+            query.prepare("VACUUM INTO ?");
+            query.addBindValue(QDir::toNativeSeparators(QFileInfo(partPath).absoluteFilePath()));
+            if (!query.exec()) {
+                summary.error = query.lastError().text();
+            }
+            query.finish();
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    if (summary.error.isEmpty()) {
+        summary.error = verifySnapshot(partPath, true);
+    }
+    if (summary.error.isEmpty()) {
+        QFile::remove(targetPath);
+        if (!QFile::rename(partPath, targetPath)) {
+            summary.error = QString("无法写入快照文件: %1").arg(targetPath);
+        }
+    }
+    if (!summary.error.isEmpty()) {
+        QFile::remove(partPath);
+        qCWarning(lcModel) << "生成快照失败:" << targetPath << summary.error;
+        return summary;
+    }
+
+    summary.bytes = QFileInfo(targetPath).size();
+    summary.elapsedMs = elapsed.elapsed();
+    qCInfo(lcModel) << "已生成快照:" << targetPath << summary.bytes << "字节，用时" << summary.elapsedMs << "ms";
+    return summary;
+}
+
+QString DatabaseBackup::verifySnapshot(const QString& snapshotPath, bool quick, int* schemaVersion)
+{
+    if (!QFileInfo::exists(snapshotPath)) {
+        return QString("快照文件不存在: %1").arg(snapshotPath);
+    }
+
+    QString error;
+    const QString connectionName = QString("library_verify_%1").arg(quintptr(QThread::currentThreadId()));
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(snapshotPath);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY");
+        if (!db.open()) {
+            error = db.lastError().text();
+        } else {
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            // 检查通过时只返回一行"ok"，否则逐条列出问题，这里只取第一条
+            if (!query.exec(quick ? "PRAGMA quick_check" : "PRAGMA integrity_check") || !query.next()) {
+                error = query.lastError().text();
+            } else if (query.value(0).toString() != "ok") {
+                error = QString("完整性检查未通过: %1").arg(query.value(0).toString());
+            }
+
+            if (error.isEmpty()) {
+                if (query.exec("PRAGMA user_version") && query.next()) {
+                    int version = query.value(0).toInt();
+                    if (schemaVersion) {
+                        *schemaVersion = version;
+                    }
+                    if (version <= 0) {
+                        error = "快照不是本系统的数据库（结构版本为0）";
+                    }
+                } else {
+                    error = query.lastError().text();
+                }
+            }
+
+            if (error.isEmpty()) {
+                QStringList tables = db.tables();
+                for (const QString& table : RequiredTables) {
+                    if (!tables.contains(table)) {
+                        error = QString("快照缺少数据表: %1").arg(table);
+                        break;
+                    }
+                }
+            }
+            query.finish();
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return error;
+}
+
+bool DatabaseBackup::restoreSnapshot(const QString& snapshotPath, const QString& dbPath, QString* error,
+                                     bool verified)
+{
+    auto fail = [error](const QString& message) {
+        qCWarning(lcModel) << "恢复快照失败:" << message;
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    // 完整检查要读遍整个快照，只做一次
+    if (!verified) {
+        QString problem = verifySnapshot(snapshotPath);
+        if (!problem.isEmpty()) {
+            return fail(problem);
+        }
+    }
+
+    // 先把快照复制到数据库旁边，替换时只需在同一目录内改名
+    QString restoringPath = dbPath + ".restoring";
+    QFile::remove(restoringPath);
+    if (!QFile::copy(snapshotPath, restoringPath)) {
+        return fail(QString("无法复制快照到: %1").arg(restoringPath));
+    }
+
+    // 原数据库连同遗留的-wal、-shm文件一起移到一旁，恢复有误时可以手动换回
+    const QString asidePath = dbPath + ".before-restore";
+    const QStringList suffixes = {"", "-wal", "-shm"};
+    for (const QString& suffix : suffixes) {
+        QFile::remove(asidePath + suffix);
+    }
+    QStringList moved;
+    for (const QString& suffix : suffixes) {
+        if (!QFile::exists(dbPath + suffix)) {
+            continue;
+        }
+        if (!QFile::rename(dbPath + suffix, asidePath + suffix)) {
+            for (const QString& done : moved) {
+                QFile::rename(asidePath + done, dbPath + done);
+            }
+            QFile::remove(restoringPath);
+            return fail(QString("无法移动数据库文件（是否仍有程序打开它？）: %1").arg(dbPath + suffix));
+        }
+        moved << suffix;
+    }
+
+    if (!QFile::rename(restoringPath, dbPath)) {
+        for (const QString& done : moved) {
+            QFile::rename(asidePath + done, dbPath + done);
+        }
+        QFile::remove(restoringPath);
+        return fail(QString("无法替换数据库文件: %1").arg(dbPath));
+    }
+
+    qCInfo(lcModel) << "已从快照恢复数据库:" << snapshotPath << "原数据库保留为" << asidePath;
+    return true;
+}
+
+QString DatabaseBackup::snapshotDirectory(const Schedule& schedule, const QString& dbPath)
+{
+    if (!schedule.directory.isEmpty()) {
+        return schedule.directory;
+    }
+    return QFileInfo(dbPath).absolutePath() + "/backups";
+}
+
+QString DatabaseBackup::newSnapshotPath(const QString& directory, const QString& dbPath)
+{
+    return QString("%1/%2-%3.db")
+        .arg(directory, QFileInfo(dbPath).completeBaseName(),
+             QDateTime::currentDateTime().toString(SnapshotTimeFormat));
+}
+
+QStringList DatabaseBackup::snapshots(const QString& directory, const QString& dbPath)
+{
+    // 文件名中的时间可以按字典序比较，倒序即最新的在前
+    QDir dir(directory);
+    QString pattern = QFileInfo(dbPath).completeBaseName() + "-????????-??????.db";
+    QStringList names = dir.entryList(QStringList() << pattern, QDir::Files, QDir::Name | QDir::Reversed);
+
+    QStringList result;
+    for (const QString& name : names) {
+        result << dir.absoluteFilePath(name);
+    }
+    return result;
+}
+
+int DatabaseBackup::prune(const QString& directory, const QString& dbPath, int keep)
+{
+    if (keep <= 0) {
+        return 0;
+    }
+
+    int removed = 0;
+    QStringList existing = snapshots(directory, dbPath);
+    for (int i = keep; i < existing.size(); i++) {
+        if (QFile::remove(existing.at(i))) {
+            removed++;
+        }
+    }
+    if (removed > 0) {
+        qCInfo(lcModel) << "已清理旧快照:" << removed << "个";
+    }
+    return removed;
+}
+
+void DatabaseBackup::setPendingRestore(const QString& snapshotPath)
+{
+    pendingRestore = snapshotPath;
+}
+
+QString DatabaseBackup::takePendingRestore()
+{
+    QString path = pendingRestore;
+    pendingRestore.clear();
+    return path;
+}
@@ -0,0 +1,87 @@
+#ifndef DATABASEBACKUP_H
+#define DATABASEBACKUP_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QString>
+#include <QStringList>
+#include <QPointer>
+
+// 数据库快照备份与恢复。
+// 快照在独立连接上用VACUUM INTO生成：整个过程读取开始时的一致快照，WAL模式下借还书等写入照常提交；
+// 先写入临时文件，快速校验通过后才改名为正式快照，失败时不留下残缺的文件。
+// 恢复前对快照做完整性检查，确认无误后整体替换数据库文件，被替换的文件保留为.before-restore
+class DatabaseBackup : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 配置文件[backup]分组
+    struct Schedule {
+        QString directory;      // 快照目录，为空时为数据库所在目录下的backups
+        int intervalHours = 0;  // 定时快照的间隔（小时），0表示不定时
+        int keep = 7;           // 保留最近的快照数量，0表示全部保留
+
+        // 配置文件由--config指定，默认为程序目录下的library.ini
+        static Schedule load(const QStringList& arguments);
+    };
+
+    struct Summary {
+        QString path;
+        qint64 bytes = 0;
+        qint64 elapsedMs = 0;
+        QString error;
+    };
+
+    explicit DatabaseBackup(QObject *parent = nullptr);
+    ~DatabaseBackup();
+
+    // 设置快照目录和定时间隔；距上次快照已超过间隔时，稍后补做一次
+    void setSchedule(const Schedule& schedule);
+    Schedule schedule() const;
+
+    // 在后台线程为当前数据库生成快照，完成后按保留数量清理旧快照。
+    // targetPath为空时按时间命名，放在快照目录中
+    bool start(const QString& targetPath = QString());
+    bool isRunning() const;
+
+    // 在当前线程生成快照（命令行模式使用），不清理旧快照
+    static Summary createSnapshot(const QString& dbPath, const QString& targetPath);
+
+    // 只读打开快照检查：quick为true时执行quick_check，否则执行完整的integrity_check，
+    // 并确认结构版本和必需的表。返回错误信息，空表示通过
+    static QString verifySnapshot(const QString& snapshotPath, bool quick = false, int* schemaVersion = nullptr);
+
+    // 用快照替换数据库文件。调用前必须关闭该数据库的所有连接。
+    // 调用方已用verifySnapshot完整检查过快照时传入verified，不再重复检查
+    static bool restoreSnapshot(const QString& snapshotPath, const QString& dbPath, QString* error = nullptr,
+                                bool verified = false);
+
+    // 快照目录与按时间命名的快照文件（<数据库名>-yyyyMMdd-HHmmss.db）
+    static QString snapshotDirectory(const Schedule& schedule, const QString& dbPath);
+    static QString newSnapshotPath(const QString& directory, const QString& dbPath);
+
+    // 目录中属于该数据库的快照，最新的在前
+    static QStringList snapshots(const QString& directory, const QString& dbPath);
+
+    // 只保留最新的keep个快照，返回删除的数量
+    static int prune(const QString& directory, const QString& dbPath, int keep);
+
+    // 界面模式下恢复需要先关闭所有连接：记下已完整检查过的快照，窗口关闭后由main()执行
+    static void setPendingRestore(const QString& snapshotPath);
+    static QString takePendingRestore();
+
+signals:
+    void finished(const QString& path, const QString& error);
+
+private slots:
+    void onTimeout();
+
+private:
+    Schedule currentSchedule;
+    QTimer timer;
+    QPointer<QThread> thread;
+};
+
+#endif // DATABASEBACKUP_H
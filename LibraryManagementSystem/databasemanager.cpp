@@ -1,4 +1,10 @@
 #include "databasemanager.h"
+#include "lookupcache.h"
+#include "holdqueue.h"
+#include "queryprofiler.h"
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadStorage>
 
 DatabaseManager& DatabaseManager::getInstance()
 {
@@ -6,17 +12,190 @@ DatabaseManager& DatabaseManager::getInstance()
     return instance;
 }
 
+// 线程结束时QThreadStorage在该线程中销毁持有者，连接随之关闭
+struct ReadConnectionHolder {
+    QString connectionName;
+    QString path;
+    ~ReadConnectionHolder();
+};
+static QThreadStorage<ReadConnectionHolder*> readConnections;
+
+ReadConnectionHolder::~ReadConnectionHolder()
+{
+    DatabaseManager::getInstance().closeReadConnection(connectionName);
+}
+
 bool DatabaseManager::initializeDatabase(const QString& dbPath)
 {
-    db = QSqlDatabase::addDatabase("QSQLITE");
+    this->dbPath = dbPath;
+    // 写连接只能在创建它的线程中使用，其他线程改用各自的读连接
+    writerThread = QThread::currentThread();
+    db = QSqlDatabase::addDatabase("QSQLITE", "library_writer");
     db.setDatabaseName(dbPath);
     
     if (!db.open()) {
-        qDebug() << "无法打开数据库:" << db.lastError().text();
+        qCWarning(lcModel) << "无法打开数据库:" << db.lastError().text();
         return false;
     }
     
-    return createTables();
+    // 应用性能参数并输出实际生效的值
+    sqliteProfile.apply(db);
+    qCInfo(lcSql) << "SQLite参数:" << SqliteProfile::describe(db);
+    
+    // 表结构在迁移之后才确定
+    return runMigrations() && tableSchema.load(db);
+}
+
+QSqlDatabase DatabaseManager::readConnection()
+{
+    if (!db.isValid() || QThread::currentThread() == writerThread) {
+        return db;
+    }
+    
+    // 已打开且指向当前数据库文件时直接复用
+    ReadConnectionHolder* holder = readConnections.localData();
+    if (holder && holder->path == dbPath) {
+        return QSqlDatabase::database(holder->connectionName, false);
+    }
+    if (holder) {
+        closeReadConnection(holder->connectionName);
+    } else {
+        holder = new ReadConnectionHolder;
+        readConnections.setLocalData(holder);
+    }
+    
+    holder->connectionName.clear();
+    holder->path.clear();
+    QString connectionName = QString("library_read_%1").arg(nextReadConnection.fetchAndAddRelaxed(1));
+    QSqlDatabase connection = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    connection.setDatabaseName(dbPath);
+    if (!connection.open()) {
+        qCWarning(lcModel) << "无法打开读连接:" << connection.lastError().text();
+        // 不缓存打开失败的连接，下次调用时重试
+        connection = QSqlDatabase();
+        QSqlDatabase::removeDatabase(connectionName);
+        return connection;
+    }
+    openReadConnections.fetchAndAddRelaxed(1);
+    holder->connectionName = connectionName;
+    holder->path = dbPath;
+    
+    sqliteProfile.apply(connection);
+    // 只读：误用读连接写入时直接报错，而不是与写连接争抢写锁
+    QSqlQuery pragma(connection);
+    pragma.exec("PRAGMA query_only = ON");
+    return connection;
+}
+
+void DatabaseManager::releaseReadConnection()
+{
+    if (readConnections.hasLocalData()) {
+        // 持有者销毁时关闭连接
+        readConnections.setLocalData(nullptr);
+    }
+}
+
+int DatabaseManager::readConnectionCount() const
+{
+    return openReadConnections.loadRelaxed();
+}
+
+void DatabaseManager::closeReadConnection(const QString& connectionName)
+{
+    if (connectionName.isEmpty()) {
+        return;
+    }
+    // 缓存的语句必须在连接所属线程中、关闭连接之前释放
+    clearStatementCache(connectionName);
+    {
+        QSqlDatabase connection = QSqlDatabase::database(connectionName, false);
+        if (connection.isOpen()) {
+            connection.close();
+            openReadConnections.fetchAndSubRelaxed(1);
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+void DatabaseManager::closeDatabase()
+{
+    QString connectionName = db.connectionName();
+    clearStatementCache(connectionName);
+    if (db.isOpen()) {
+        db.close();
+    }
+    db = QSqlDatabase();
+    writerThread = nullptr;
+    QSqlDatabase::removeDatabase(connectionName);
+    
+    // 内存索引属于当前数据库文件
+    LookupCache::getInstance().clear();
+    HoldQueue::getInstance().clear();
+    tableSchema.clear();
+    ftsEnabled = false;
+    currentSchemaVersion = 0;
+}
+
+bool DatabaseManager::runMigrations()
+{
+    // 按版本号排列的迁移，新迁移追加在末尾，已发布的迁移不能修改
+    static const Migration migrations[] = {
+        {1, "创建基础表结构", &DatabaseManager::createTables},
+        {2, "创建图书全文索引", &DatabaseManager::createBookSearchIndex},
+        {3, "创建借阅记录二级索引", &DatabaseManager::createCirculationIndexes},
+        {4, "创建统计计数表", &DatabaseManager::createStatisticsCounters},
+        {5, "创建图书分类字典", &DatabaseManager::createCategoryDictionary},
+        {6, "创建借阅记录归档表", &DatabaseManager::createLoanArchive},
+        {7, "创建图书预约表", &DatabaseManager::createHolds},
+    };
+    
+    // 已是最新版本时只需这一次读取
+    QSqlQuery query(db);
+    if (!query.exec("SELECT (SELECT user_version FROM pragma_user_version), "
+                    "EXISTS(SELECT 1 FROM sqlite_master WHERE type='table' AND name='books_fts')")
+        || !query.next()) {
+        qCWarning(lcModel) << "读取数据库版本失败:" << query.lastError().text();
+        return false;
+    }
+    currentSchemaVersion = query.value(0).toInt();
+    ftsEnabled = query.value(1).toBool();
+    query.finish();
+    
+    bool migrated = false;
+    for (const Migration& migration : migrations) {
+        if (migration.version <= currentSchemaVersion) {
+            continue;
+        }
+        
+        qCInfo(lcModel) << "执行数据库迁移" << migration.version << ":" << migration.description;
+        if (!query.exec("BEGIN IMMEDIATE")) {
+            qCWarning(lcModel) << "开始迁移事务失败:" << query.lastError().text();
+            return false;
+        }
+        
+        // 迁移内容与版本号在同一个事务中提交
+        if (!(this->*migration.apply)()
+            || !query.exec(QString("PRAGMA user_version = %1").arg(migration.version))
+            || !db.commit()) {
+            qCWarning(lcModel) << "数据库迁移失败:" << migration.version << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+        
+        currentSchemaVersion = migration.version;
+        migrated = true;
+    }
+    
+    if (migrated) {
+        ftsEnabled = query.exec("SELECT 1 FROM sqlite_master WHERE type='table' AND name='books_fts'")
+                     && query.next();
+        query.finish();
+    }
+    if (!ftsEnabled) {
+        qCWarning(lcModel) << "图书全文索引不可用，检索将使用LIKE匹配";
+    }
+    
+    return true;
 }
 
 bool DatabaseManager::createTables()
@@ -43,13 +222,13 @@ bool DatabaseManager::createTables()
     )";
     
     if (!query.exec(createBooksTable)) {
-        qDebug() << "创建图书表失败:" << query.lastError().text();
+        qCWarning(lcModel) << "创建图书表失败:" << query.lastError().text();
         return false;
     }
     
     // 检查并修复表结构
     if (!checkAndFixTableStructure()) {
-        qDebug() << "检查表结构失败";
+        qCWarning(lcModel) << "检查表结构失败";
         return false;
     }
     
@@ -69,7 +248,7 @@ bool DatabaseManager::createTables()
     )";
     
     if (!query.exec(createReadersTable)) {
-        qDebug() << "创建读者表失败:" << query.lastError().text();
+        qCWarning(lcModel) << "创建读者表失败:" << query.lastError().text();
         return false;
     }
     
@@ -90,18 +269,537 @@ bool DatabaseManager::createTables()
     )";
     
     if (!query.exec(createBorrowTable)) {
-        qDebug() << "创建借阅记录表失败:" << query.lastError().text();
+        qCWarning(lcModel) << "创建借阅记录表失败:" << query.lastError().text();
         return false;
     }
     
     return true;
 }
 
+bool DatabaseManager::createCirculationIndexes()
+{
+    QSqlQuery query(db);
+    
+    // 逾期查询与统计：status + due_date 覆盖 WHERE status=? AND due_date<?
+    // 读者/图书的借阅查询：按 reader_id、book_isbn 定位，再按状态过滤
+    QStringList indexes;
+    indexes << "CREATE INDEX IF NOT EXISTS idx_borrow_status_due ON borrow_records(status, due_date)"
+            << "CREATE INDEX IF NOT EXISTS idx_borrow_reader_status ON borrow_records(reader_id, status)"
+            << "CREATE INDEX IF NOT EXISTS idx_borrow_isbn_status ON borrow_records(book_isbn, status)"
+            << "CREATE INDEX IF NOT EXISTS idx_books_category ON books(category)";
+    
+    for (const QString& index : indexes) {
+        if (!query.exec(index)) {
+            qCWarning(lcModel) << "创建索引失败:" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    // 为查询规划器收集新索引的统计信息
+    if (!query.exec("ANALYZE")) {
+        qCWarning(lcModel) << "收集索引统计信息失败:" << query.lastError().text();
+    }
+    
+    return true;
+}
+
+bool DatabaseManager::createBookSearchIndex()
+{
+    QSqlQuery query(db);
+    
+    // 新建索引时需要用books表中已有的数据重建
+    bool indexExists = query.exec("SELECT 1 FROM sqlite_master WHERE type='table' AND name='books_fts'")
+                       && query.next();
+    
+    // 外部内容表：索引只保存词条，内容仍从books表读取
+    QString createFtsTable = R"(
+        CREATE VIRTUAL TABLE IF NOT EXISTS books_fts USING fts5(
+            isbn, title, author, publisher, category,
+            content='books',
+            content_rowid='id',
+            tokenize='unicode61',
+            prefix='1 2 3'
+        )
+    )";
+    
+    if (!query.exec(createFtsTable)) {
+        // SQLite未编译FTS5时跳过，检索回退为LIKE匹配
+        if (query.lastError().text().contains("no such module")) {
+            qCWarning(lcModel) << "SQLite不支持FTS5，跳过图书全文索引";
+            return true;
+        }
+        qCWarning(lcModel) << "创建图书全文索引失败:" << query.lastError().text();
+        return false;
+    }
+    
+    // 通过触发器与books表保持同步；只有被索引的列变化时才更新索引
+    QStringList triggers;
+    triggers << R"(
+        CREATE TRIGGER IF NOT EXISTS books_fts_ai AFTER INSERT ON books BEGIN
+            INSERT INTO books_fts(rowid, isbn, title, author, publisher, category)
+            VALUES (new.id, new.isbn, new.title, new.author, new.publisher, new.category);
+        END
+    )";
+    triggers << R"(
+        CREATE TRIGGER IF NOT EXISTS books_fts_ad AFTER DELETE ON books BEGIN
+            INSERT INTO books_fts(books_fts, rowid, isbn, title, author, publisher, category)
+            VALUES ('delete', old.id, old.isbn, old.title, old.author, old.publisher, old.category);
+        END
+    )";
+    triggers << R"(
+        CREATE TRIGGER IF NOT EXISTS books_fts_au
+        AFTER UPDATE OF isbn, title, author, publisher, category ON books BEGIN
+            INSERT INTO books_fts(books_fts, rowid, isbn, title, author, publisher, category)
+            VALUES ('delete', old.id, old.isbn, old.title, old.author, old.publisher, old.category);
+            INSERT INTO books_fts(rowid, isbn, title, author, publisher, category)
+            VALUES (new.id, new.isbn, new.title, new.author, new.publisher, new.category);
+        END
+    )";
+    
+    for (const QString& trigger : triggers) {
+        if (!query.exec(trigger)) {
+            qCWarning(lcModel) << "创建全文索引触发器失败:" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    if (!indexExists) {
+        if (!query.exec("INSERT INTO books_fts(books_fts) VALUES('rebuild')")) {
+            qCWarning(lcModel) << "重建图书全文索引失败:" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// 各统计计数及其从原表重新统计的语句；archiveSql为归档表中同样计入的部分（借阅、归还总数包含已归档的记录），
+// 初始化计数的迁移早于归档表，只使用countSql
+static const struct {
+    const char* name;
+    const char* countSql;
+    const char* archiveSql;
+} counterDefinitions[] = {
+    {"books", "SELECT COUNT(*) FROM books", nullptr},
+    {"readers", "SELECT COUNT(*) FROM readers", nullptr},
+    {"total_borrows", "SELECT COUNT(*) FROM borrow_records", "SELECT COUNT(*) FROM borrow_records_archive"},
+    {"current_borrows", "SELECT COUNT(*) FROM borrow_records WHERE status='借出'", nullptr},
+    {"total_returns", "SELECT COUNT(*) FROM borrow_records WHERE status='已归还'",
+     "SELECT COUNT(*) FROM borrow_records_archive WHERE status='已归还'"},
+};
+
+bool DatabaseManager::createStatisticsCounters()
+{
+    QSqlQuery query(db);
+    
+    if (!query.exec("CREATE TABLE IF NOT EXISTS stats_counters ("
+                    "name TEXT PRIMARY KEY, value INTEGER NOT NULL DEFAULT 0) WITHOUT ROWID")) {
+        qCWarning(lcModel) << "创建统计计数表失败:" << query.lastError().text();
+        return false;
+    }
+    
+    // 用现有数据初始化计数（与迁移在同一事务中，期间不会有其他写入）
+    for (const auto& counter : counterDefinitions) {
+        if (!query.exec(QString("INSERT OR REPLACE INTO stats_counters (name, value) VALUES ('%1', (%2))")
+                        .arg(counter.name, counter.countSql))) {
+            qCWarning(lcModel) << "初始化统计计数失败:" << counter.name << query.lastError().text();
+            return false;
+        }
+    }
+    
+    // 状态比较使用IS，status为NULL时结果为0而不是NULL
+    QStringList triggers;
+    triggers << R"(
+        CREATE TRIGGER IF NOT EXISTS stats_books_ai AFTER INSERT ON books BEGIN
+            UPDATE stats_counters SET value = value + 1 WHERE name = 'books';
+        END
+    )";
+    triggers << R"(
+        CREATE TRIGGER IF NOT EXISTS stats_books_ad AFTER DELETE ON books BEGIN
+            UPDATE stats_counters SET value = value - 1 WHERE name = 'books';
+        END
+    )";
+    triggers << R"(
+        CREATE TRIGGER IF NOT EXISTS stats_readers_ai AFTER INSERT ON readers BEGIN
+            UPDATE stats_counters SET value = value + 1 WHERE name = 'readers';
+        END
+    )";
+    triggers << R"(
+        CREATE TRIGGER IF NOT EXISTS stats_readers_ad AFTER DELETE ON readers BEGIN
+            UPDATE stats_counters SET value = value - 1 WHERE name = 'readers';
+        END
+    )";
+    triggers << R"(
+        CREATE TRIGGER IF NOT EXISTS stats_borrow_ai AFTER INSERT ON borrow_records BEGIN
+            UPDATE stats_counters SET value = value + CASE name
+                WHEN 'total_borrows' THEN 1
+                WHEN 'current_borrows' THEN (new.status IS '借出')
+                ELSE (new.status IS '已归还') END
+            WHERE name IN ('total_borrows', 'current_borrows', 'total_returns');
+        END
+    )";
+    triggers << R"(
+        CREATE TRIGGER IF NOT EXISTS stats_borrow_ad AFTER DELETE ON borrow_records BEGIN
+            UPDATE stats_counters SET value = value - CASE name
+                WHEN 'total_borrows' THEN 1
+                WHEN 'current_borrows' THEN (old.status IS '借出')
+                ELSE (old.status IS '已归还') END
+            WHERE name IN ('total_borrows', 'current_borrows', 'total_returns');
+        END
+    )";
+    triggers << R"(
+        CREATE TRIGGER IF NOT EXISTS stats_borrow_au AFTER UPDATE OF status ON borrow_records
+        WHEN old.status IS NOT new.status BEGIN
+            UPDATE stats_counters SET value = value + CASE name
+                WHEN 'current_borrows' THEN (new.status IS '借出') - (old.status IS '借出')
+                ELSE (new.status IS '已归还') - (old.status IS '已归还') END
+            WHERE name IN ('current_borrows', 'total_returns');
+        END
+    )";
+    
+    for (const QString& trigger : triggers) {
+        if (!query.exec(trigger)) {
+            qCWarning(lcModel) << "创建统计计数触发器失败:" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool DatabaseManager::createCategoryDictionary()
+{
+    QSqlQuery query(db);
+    
+    // 分类名称只保存一份，books.category_id引用它；book_count为该分类的图书数量。
+    // 数量归零的分类保留，ID保持不变
+    QStringList statements;
+    statements << "CREATE TABLE IF NOT EXISTS categories ("
+                  "id INTEGER PRIMARY KEY, name TEXT UNIQUE NOT NULL, book_count INTEGER NOT NULL DEFAULT 0)"
+               << "ALTER TABLE books ADD COLUMN category_id INTEGER REFERENCES categories(id)"
+               << "INSERT OR IGNORE INTO categories (name, book_count) "
+                  "SELECT category, COUNT(*) FROM books "
+                  "WHERE category IS NOT NULL AND category != '' GROUP BY category"
+               << "UPDATE books SET category_id = (SELECT id FROM categories c WHERE c.name = books.category)"
+               << "CREATE INDEX IF NOT EXISTS idx_books_category_id ON books(category_id)";
+    
+    for (const QString& statement : statements) {
+        if (!query.exec(statement)) {
+            qCWarning(lcModel) << "创建分类字典失败:" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    // 触发器维护分类行、图书数量和books.category_id，批量导入等独立连接的写入也保持一致；
+    // 触发器内对books的更新只涉及category_id，不会再次触发分类或全文索引的触发器
+    QStringList triggers;
+    triggers << R"(
+        CREATE TRIGGER IF NOT EXISTS categories_books_ai AFTER INSERT ON books
+        WHEN new.category IS NOT NULL AND new.category != '' BEGIN
+            INSERT OR IGNORE INTO categories (name) VALUES (new.category);
+            UPDATE categories SET book_count = book_count + 1 WHERE name = new.category;
+            UPDATE books SET category_id = (SELECT id FROM categories WHERE name = new.category)
+            WHERE id = new.id;
+        END
+    )";
+    triggers << R"(
+        CREATE TRIGGER IF NOT EXISTS categories_books_ad AFTER DELETE ON books
+        WHEN old.category IS NOT NULL AND old.category != '' BEGIN
+            UPDATE categories SET book_count = book_count - 1 WHERE name = old.category;
+        END
+    )";
+    triggers << R"(
+        CREATE TRIGGER IF NOT EXISTS categories_books_au AFTER UPDATE OF category ON books
+        WHEN old.category IS NOT new.category BEGIN
+            UPDATE categories SET book_count = book_count - 1 WHERE name = old.category;
+            INSERT OR IGNORE INTO categories (name)
+            SELECT new.category WHERE new.category IS NOT NULL AND new.category != '';
+            UPDATE categories SET book_count = book_count + 1 WHERE name = new.category;
+            UPDATE books SET category_id = (SELECT id FROM categories WHERE name = new.category)
+            WHERE id = new.id;
+        END
+    )";
+    
+    for (const QString& trigger : triggers) {
+        if (!query.exec(trigger)) {
+            qCWarning(lcModel) << "创建分类字典触发器失败:" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool DatabaseManager::createLoanArchive()
+{
+    QSqlQuery query(db);
+    
+    // 已归还的旧记录移到归档表，borrow_records只保留借出中和近期归还的记录，
+    // 逾期查询、统计和借阅列表不再扫描多年的历史；列与borrow_records一致，另记归档日期。
+    // borrow_records使用AUTOINCREMENT，记录ID不会被重用，归档后仍然唯一
+    QStringList statements;
+    statements << R"(
+        CREATE TABLE IF NOT EXISTS borrow_records_archive (
+            id INTEGER PRIMARY KEY,
+            reader_id TEXT NOT NULL,
+            book_isbn TEXT NOT NULL,
+            borrow_date TEXT NOT NULL,
+            due_date TEXT NOT NULL,
+            return_date TEXT,
+            status TEXT,
+            fine_amount REAL DEFAULT 0,
+            archived_date TEXT
+        )
+    )"
+               << "CREATE INDEX IF NOT EXISTS idx_archive_reader ON borrow_records_archive(reader_id, id)"
+               << "CREATE INDEX IF NOT EXISTS idx_archive_isbn ON borrow_records_archive(book_isbn)"
+               // 归档时先写入归档表再删除，删除已归档的记录不减少借阅、归还总数
+               << "DROP TRIGGER IF EXISTS stats_borrow_ad"
+               << R"(
+        CREATE TRIGGER stats_borrow_ad AFTER DELETE ON borrow_records
+        WHEN NOT EXISTS (SELECT 1 FROM borrow_records_archive WHERE id = old.id) BEGIN
+            UPDATE stats_counters SET value = value - CASE name
+                WHEN 'total_borrows' THEN 1
+                WHEN 'current_borrows' THEN (old.status IS '借出')
+                ELSE (old.status IS '已归还') END
+            WHERE name IN ('total_borrows', 'current_borrows', 'total_returns');
+        END
+    )";
+    
+    for (const QString& statement : statements) {
+        if (!query.exec(statement)) {
+            qCWarning(lcModel) << "创建借阅记录归档表失败:" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool DatabaseManager::createHolds()
+{
+    QSqlQuery query(db);
+    
+    // 图书无可借副本时登记预约，还书时按预约时间先后留给等待的读者。
+    // status：等待、已到书（副本已保留，不计入可借册数）、已借出、已取消
+    QStringList statements;
+    statements << R"(
+        CREATE TABLE IF NOT EXISTS holds (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            book_isbn TEXT NOT NULL,
+            reader_id TEXT NOT NULL,
+            created TEXT NOT NULL,
+            status TEXT NOT NULL DEFAULT '等待',
+            ready_date TEXT,
+            closed_date TEXT,
+            FOREIGN KEY (reader_id) REFERENCES readers(reader_id),
+            FOREIGN KEY (book_isbn) REFERENCES books(isbn)
+        )
+    )"
+               << "CREATE INDEX IF NOT EXISTS idx_holds_isbn_created ON holds(book_isbn, created)"
+               << "CREATE INDEX IF NOT EXISTS idx_holds_reader_status ON holds(reader_id, status)";
+    
+    for (const QString& statement : statements) {
+        if (!query.exec(statement)) {
+            qCWarning(lcModel) << "创建图书预约表失败:" << query.lastError().text();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+QHash<QString, qint64> DatabaseManager::readCounters(const QSqlDatabase& database)
+{
+    QHash<QString, qint64> counters;
+    QSqlQuery query = preparedQuery("SELECT name, value FROM stats_counters", database);
+    if (query.exec()) {
+        while (query.next()) {
+            counters.insert(query.value(0).toString(), query.value(1).toLongLong());
+        }
+    } else {
+        qCWarning(lcModel) << "读取统计计数失败:" << query.lastError().text();
+    }
+    query.finish();
+    return counters;
+}
+
+QStringList DatabaseManager::verifyCounters(bool repair)
+{
+    QStringList mismatches;
+    QSqlQuery query(db);
+    
+    // 在同一个读事务中统计，结果与计数表处于同一快照；修复时需要写锁
+    if (!query.exec(repair ? "BEGIN IMMEDIATE" : "BEGIN")) {
+        mismatches << "开始事务失败: " + query.lastError().text();
+        return mismatches;
+    }
+    
+    QHash<QString, qint64> stored = readCounters();
+    bool archived = tableSchema.table("borrow_records_archive").isValid();
+    for (const auto& counter : counterDefinitions) {
+        QString countSql = QString::fromUtf8(counter.countSql);
+        if (archived && counter.archiveSql) {
+            countSql = QString("SELECT (%1) + (%2)").arg(countSql, QString::fromUtf8(counter.archiveSql));
+        }
+        if (!query.exec(countSql) || !query.next()) {
+            mismatches << QString("%1: 重新统计失败 %2").arg(counter.name, query.lastError().text());
+            continue;
+        }
+        qint64 actual = query.value(0).toLongLong();
+        query.finish();
+        
+        auto it = stored.constFind(counter.name);
+        if (it != stored.constEnd() && it.value() == actual) {
+            continue;
+        }
+        mismatches << QString("%1: 计数表 %2，实际 %3")
+                      .arg(counter.name)
+                      .arg(it != stored.constEnd() ? QString::number(it.value()) : QString("缺失"))
+                      .arg(actual);
+        
+        if (repair) {
+            query.prepare("INSERT OR REPLACE INTO stats_counters (name, value) VALUES (?, ?)");
+            query.addBindValue(QString(counter.name));
+            query.addBindValue(actual);
+            if (!query.exec()) {
+                qCWarning(lcModel) << "修复统计计数失败:" << counter.name << query.lastError().text();
+            }
+        }
+    }
+    
+    if (repair) {
+        db.commit();
+    } else {
+        query.exec("COMMIT");
+    }
+    
+    if (!mismatches.isEmpty()) {
+        qCWarning(lcModel) << "统计计数不一致:" << mismatches;
+    }
+    return mismatches;
+}
+
 QSqlDatabase DatabaseManager::getDatabase() const
 {
     return db;
 }
 
+QString DatabaseManager::databasePath() const
+{
+    return dbPath;
+}
+
+void DatabaseManager::setProfile(const SqliteProfile& profile)
+{
+    sqliteProfile = profile;
+}
+
+SqliteProfile DatabaseManager::profile() const
+{
+    return sqliteProfile;
+}
+
+int DatabaseManager::schemaVersion() const
+{
+    return currentSchemaVersion;
+}
+
+bool DatabaseManager::isFullTextSearchEnabled() const
+{
+    return ftsEnabled;
+}
+
+const SchemaDescriptor& DatabaseManager::schema() const
+{
+    return tableSchema;
+}
+
+QSqlQuery DatabaseManager::preparedQuery(const QString& sql, const QSqlDatabase& database, bool* ok)
+{
+    QSqlDatabase connection = database.isValid() ? database : db;
+    QString key = connection.connectionName() + QLatin1Char('\x1f') + sql;
+    
+    QMutexLocker locker(&statementCacheMutex);
+    auto it = statementCache.constFind(key);
+    if (it != statementCache.constEnd()) {
+        statementCacheHits.fetchAndAddRelaxed(1);
+        QSqlQuery query = it.value();
+        // 复位上一次未读完的结果集
+        query.finish();
+        if (ok) {
+            *ok = true;
+        }
+        return query;
+    }
+    
+    statementCacheMisses.fetchAndAddRelaxed(1);
+    QSqlQuery query(connection);
+    bool prepared = query.prepare(sql);
+    if (prepared) {
+        // 带有内联关键词的查询文本各不相同，缓存过大时清空该连接的语句
+        if (statementCache.size() >= MaxCachedStatements) {
+            removeCachedStatements(connection.connectionName());
+        }
+        statementCache.insert(key, query);
+    } else {
+        qCWarning(lcSql) << "预编译语句失败:" << query.lastError().text() << sql;
+    }
+    if (ok) {
+        *ok = prepared;
+    }
+    return query;
+}
+
+bool DatabaseManager::exec(QSqlQuery& query)
+{
+    QueryProfiler& profiler = QueryProfiler::getInstance();
+    if (!profiler.isEnabled()) {
+        return query.exec();
+    }
+    
+    QElapsedTimer timer;
+    timer.start();
+    bool success = query.exec();
+    qint64 elapsed = timer.nsecsElapsed();
+    // 查询语句此时只读到第一行，行数未知
+    qint64 rows = success && !query.isSelect() ? query.numRowsAffected() : -1;
+    profiler.record(query, elapsed, rows, success);
+    return success;
+}
+
+void DatabaseManager::clearStatementCache(const QString& connectionName)
+{
+    QMutexLocker locker(&statementCacheMutex);
+    if (connectionName.isEmpty()) {
+        statementCache.clear();
+        return;
+    }
+    removeCachedStatements(connectionName);
+}
+
+void DatabaseManager::removeCachedStatements(const QString& connectionName)
+{
+    QString prefix = connectionName + QLatin1Char('\x1f');
+    for (auto it = statementCache.begin(); it != statementCache.end();) {
+        if (it.key().startsWith(prefix)) {
+            it = statementCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+DatabaseManager::StatementCacheStats DatabaseManager::statementCacheStats() const
+{
+    QMutexLocker locker(&statementCacheMutex);
+    StatementCacheStats stats;
+    stats.hits = statementCacheHits.loadRelaxed();
+    stats.misses = statementCacheMisses.loadRelaxed();
+    stats.cachedStatements = statementCache.size();
+    return stats;
+}
+
 bool DatabaseManager::executeQuery(const QString& queryStr)
 {
     QSqlQuery query(db);
@@ -119,20 +817,20 @@ bool DatabaseManager::checkAndFixTableStructure()
             columns << query.value(1).toString().toLower();
         }
         
-        qDebug() << "books表现有列:" << columns;
+        qCDebug(lcModel) << "books表现有列:" << columns;
         
         // 检查必需的列是否存在
         if (!columns.contains("total_copies")) {
-            qDebug() << "添加缺失的列: total_copies";
+            qCInfo(lcModel) << "添加缺失的列: total_copies";
             if (!query.exec("ALTER TABLE books ADD COLUMN total_copies INTEGER DEFAULT 1")) {
-                qDebug() << "添加total_copies列失败:" << query.lastError().text();
+                qCWarning(lcModel) << "添加total_copies列失败:" << query.lastError().text();
             }
         }
         
         if (!columns.contains("available_copies")) {
-            qDebug() << "添加缺失的列: available_copies";
+            qCInfo(lcModel) << "添加缺失的列: available_copies";
             if (!query.exec("ALTER TABLE books ADD COLUMN available_copies INTEGER DEFAULT 1")) {
-                qDebug() << "添加available_copies列失败:" << query.lastError().text();
+                qCWarning(lcModel) << "添加available_copies列失败:" << query.lastError().text();
             } else {
                 // 如果新添加了available_copies列，将现有记录的available_copies设置为total_copies
                 query.exec("UPDATE books SET available_copies = total_copies WHERE available_copies IS NULL");
@@ -140,16 +838,16 @@ bool DatabaseManager::checkAndFixTableStructure()
         }
         
         if (!columns.contains("create_time")) {
-            qDebug() << "添加缺失的列: create_time";
+            qCInfo(lcModel) << "添加缺失的列: create_time";
             if (!query.exec("ALTER TABLE books ADD COLUMN create_time TEXT")) {
-                qDebug() << "添加create_time列失败:" << query.lastError().text();
+                qCWarning(lcModel) << "添加create_time列失败:" << query.lastError().text();
             }
         }
         
         if (!columns.contains("update_time")) {
-            qDebug() << "添加缺失的列: update_time";
+            qCInfo(lcModel) << "添加缺失的列: update_time";
             if (!query.exec("ALTER TABLE books ADD COLUMN update_time TEXT")) {
-                qDebug() << "添加update_time列失败:" << query.lastError().text();
+                qCWarning(lcModel) << "添加update_time列失败:" << query.lastError().text();
             }
         }
     }
@@ -161,26 +859,26 @@ bool DatabaseManager::checkAndFixTableStructure()
             columns << query.value(1).toString().toLower();
         }
         
-        qDebug() << "readers表现有列:" << columns;
+        qCDebug(lcModel) << "readers表现有列:" << columns;
         
         if (!columns.contains("address")) {
-            qDebug() << "添加缺失的列: address";
+            qCInfo(lcModel) << "添加缺失的列: address";
             if (!query.exec("ALTER TABLE readers ADD COLUMN address TEXT")) {
-                qDebug() << "添加address列失败:" << query.lastError().text();
+                qCWarning(lcModel) << "添加address列失败:" << query.lastError().text();
             }
         }
         
         if (!columns.contains("update_time")) {
-            qDebug() << "添加缺失的列: update_time";
+            qCInfo(lcModel) << "添加缺失的列: update_time";
             if (!query.exec("ALTER TABLE readers ADD COLUMN update_time TEXT")) {
-                qDebug() << "添加update_time列失败:" << query.lastError().text();
+                qCWarning(lcModel) << "添加update_time列失败:" << query.lastError().text();
             }
         }
         
         if (!columns.contains("create_time")) {
-            qDebug() << "添加缺失的列: create_time";
+            qCInfo(lcModel) << "添加缺失的列: create_time";
             if (!query.exec("ALTER TABLE readers ADD COLUMN create_time TEXT")) {
-                qDebug() << "添加create_time列失败:" << query.lastError().text();
+                qCWarning(lcModel) << "添加create_time列失败:" << query.lastError().text();
             }
         }
     }
@@ -5,24 +5,118 @@
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QString>
-#include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInteger>
+#include <QThread>
+#include "sqliteprofile.h"
+#include "schemadescriptor.h"
 
 class DatabaseManager
 {
 public:
     static DatabaseManager& getInstance();
     bool initializeDatabase(const QString& dbPath);
+    
+    // 关闭主连接并释放其缓存语句（切换数据库文件前调用，调用前应先销毁使用该连接的模型）
+    void closeDatabase();
+    // 写连接（连接名library_writer），属于界面线程（命令行模式为主线程）；所有增删改都经过它
     QSqlDatabase getDatabase() const;
+    QString databasePath() const;
+    
+    // 读连接池：每个线程一个只读连接（query_only），WAL模式下各自读取一致的快照，
+    // 与写连接和其他读连接并行，不争用同一个连接。连接在首次调用时打开，线程结束时自动关闭；
+    // 在写连接所属线程中调用时直接返回写连接
+    QSqlDatabase readConnection();
+    
+    // 提前关闭当前线程的读连接（线程退出前释放缓存语句时调用）
+    void releaseReadConnection();
+    
+    // 当前打开的读连接数
+    int readConnectionCount() const;
+    
+    // SQLite性能参数，在initializeDatabase之前设置；之后打开的每个连接都会应用
+    void setProfile(const SqliteProfile& profile);
+    SqliteProfile profile() const;
     bool executeQuery(const QString& query);
     
+    // 当前数据库结构版本（PRAGMA user_version）
+    int schemaVersion() const;
+    
+    // 图书全文索引（FTS5）是否可用
+    bool isFullTextSearchEnabled() const;
+    
+    // 各表的列（迁移完成后读取一次），按字段名取列号、判断旧版数据库是否有某列
+    const SchemaDescriptor& schema() const;
+    
+    // 预编译语句缓存：同一连接上相同的SQL只prepare一次，之后直接复用
+    // 返回的查询与缓存共享同一条语句，读取完结果后应调用finish()释放
+    QSqlQuery preparedQuery(const QString& sql, const QSqlDatabase& database = QSqlDatabase(), bool* ok = nullptr);
+    
+    // 执行查询；开启性能分析时记录耗时和影响的行数（见QueryProfiler）
+    bool exec(QSqlQuery& query);
+    
+    // 清空语句缓存；指定连接名时只清空该连接的语句（关闭连接前调用）
+    void clearStatementCache(const QString& connectionName = QString());
+    
+    struct StatementCacheStats {
+        quint64 hits;
+        quint64 misses;
+        int cachedStatements;
+    };
+    StatementCacheStats statementCacheStats() const;
+    
+    // 统计计数：books、readers、total_borrows、current_borrows、total_returns，
+    // 由触发器在增删改的同一事务中维护，读取代价与表大小无关
+    QHash<QString, qint64> readCounters(const QSqlDatabase& database = QSqlDatabase());
+    
+    // 从原表重新统计并与计数表比对，返回不一致项的说明；repair为true时写回重新统计的值
+    QStringList verifyCounters(bool repair = false);
+    
 private:
+    friend struct ReadConnectionHolder;
+
     DatabaseManager() = default;
     ~DatabaseManager() = default;
     DatabaseManager(const DatabaseManager&) = delete;
     DatabaseManager& operator=(const DatabaseManager&) = delete;
     
     QSqlDatabase db;
+    QThread* writerThread = nullptr;  // 写连接所属线程
+    QString dbPath;
+    SqliteProfile sqliteProfile;
+    bool ftsEnabled = false;
+    int currentSchemaVersion = 0;
+    
+    // 键为“连接名 + SQL”
+    static const int MaxCachedStatements = 512;
+    QHash<QString, QSqlQuery> statementCache;
+    mutable QMutex statementCacheMutex;
+    QAtomicInteger<quint64> statementCacheHits = 0;
+    QAtomicInteger<quint64> statementCacheMisses = 0;
+    
+    SchemaDescriptor tableSchema;
+    
+    QAtomicInteger<int> openReadConnections = 0;
+    QAtomicInteger<int> nextReadConnection = 0;
+    void closeReadConnection(const QString& connectionName);
+    
+    void removeCachedStatements(const QString& connectionName);
+    
+    // 数据库迁移：按版本号顺序执行，每个迁移在独立事务中完成并更新user_version
+    struct Migration {
+        int version;
+        const char* description;
+        bool (DatabaseManager::*apply)();
+    };
+    bool runMigrations();
     bool createTables();
+    bool createBookSearchIndex();
+    bool createCirculationIndexes();
+    bool createStatisticsCounters();
+    bool createCategoryDictionary();
+    bool createLoanArchive();
+    bool createHolds();
     bool checkAndFixTableStructure();
 };
 
@@ -0,0 +1,243 @@
+#include "databaseworker.h"
+#include "databasemanager.h"
+#include "queryprofiler.h"
+#include <QCoreApplication>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <utility>
+
+void QueryRunner::open()
+{
+    // 与写连接使用相同的性能参数（busy_timeout使写操作持锁时等待而不是返回SQLITE_BUSY）
+    QSqlDatabase db = DatabaseManager::getInstance().readConnection();
+    if (!db.isOpen()) {
+        qCWarning(lcModel) << "工作线程无法打开数据库:" << db.lastError().text();
+        return;
+    }
+    connectionName = db.connectionName();
+}
+
+void QueryRunner::close()
+{
+    // 连接必须在所属线程中关闭
+    DatabaseManager::getInstance().releaseReadConnection();
+    connectionName.clear();
+}
+
+void QueryRunner::run(int ticket, const QString& sql, const QVariantList& values)
+{
+    struct Dequeue {
+        QAtomicInteger<int>& counter;
+        ~Dequeue() { counter.fetchAndSubRelaxed(1); }
+    } dequeue{queued};
+
+    // 已被新请求取代的查询直接丢弃
+    if (DatabaseWorker::getInstance().takeCancelled(ticket)) {
+        return;
+    }
+
+    QueryResult result;
+    result.ticket = ticket;
+
+    // 分页、统计等查询的SQL文本固定，复用本连接上已预编译的语句
+    bool prepared = false;
+    QSqlQuery query = DatabaseManager::getInstance().preparedQuery(
+        sql, QSqlDatabase::database(connectionName), &prepared);
+    if (!prepared) {
+        result.error = query.lastError().text();
+        emit finished(result);
+        return;
+    }
+    query.setForwardOnly(true);
+    for (const QVariant& value : values) {
+        query.addBindValue(value);
+    }
+
+    // 后台查询的耗时包括读取全部结果，同时记录返回的行数
+    QueryProfiler& profiler = QueryProfiler::getInstance();
+    const bool profiling = profiler.isEnabled();
+    QElapsedTimer timer;
+    if (profiling) {
+        timer.start();
+    }
+
+    if (!query.exec()) {
+        result.error = query.lastError().text();
+        if (profiling) {
+            profiler.record(query, timer.nsecsElapsed(), -1, false);
+        }
+        emit finished(result);
+        return;
+    }
+
+    int columnCount = query.record().count();
+    while (query.next()) {
+        QVariantList row;
+        row.reserve(columnCount);
+        for (int i = 0; i < columnCount; i++) {
+            row << query.value(i);
+        }
+        result.rows.append(row);
+    }
+    if (profiling) {
+        profiler.record(query, timer.nsecsElapsed(), result.rows.size(), true);
+    }
+    query.finish();
+
+    result.success = true;
+    emit finished(result);
+}
+
+DatabaseWorker& DatabaseWorker::getInstance()
+{
+    static DatabaseWorker instance;
+    return instance;
+}
+
+DatabaseWorker::~DatabaseWorker()
+{
+    stop();
+}
+
+bool DatabaseWorker::start(int threadCount)
+{
+    if (!runners.isEmpty()) {
+        return true;
+    }
+
+    qRegisterMetaType<QueryResult>("QueryResult");
+
+    if (threadCount <= 0) {
+        threadCount = qBound(2, QThread::idealThreadCount() / 2, 4);
+    }
+
+    for (int i = 0; i < threadCount; i++) {
+        QThread* thread = new QThread;
+        QueryRunner* runner = new QueryRunner;
+        runner->moveToThread(thread);
+        connect(thread, &QThread::started, runner, &QueryRunner::open);
+        connect(runner, &QueryRunner::finished, this, &DatabaseWorker::onRunnerFinished, Qt::QueuedConnection);
+        thread->setObjectName(QString("DatabaseWorker-%1").arg(i));
+        threads.append(thread);
+        runners.append(runner);
+    }
+
+    // 应用退出前关闭工作线程，保证连接在所属线程中释放
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                this, &DatabaseWorker::stop, Qt::UniqueConnection);
+    }
+
+    for (QThread* thread : std::as_const(threads)) {
+        thread->start();
+    }
+    return true;
+}
+
+void DatabaseWorker::stop()
+{
+    if (runners.isEmpty()) {
+        return;
+    }
+
+    for (int i = 0; i < runners.size(); i++) {
+        QMetaObject::invokeMethod(runners.at(i), "close", Qt::BlockingQueuedConnection);
+        threads.at(i)->quit();
+        threads.at(i)->wait();
+        delete runners.at(i);
+        delete threads.at(i);
+    }
+    runners.clear();
+    threads.clear();
+    callbacks.clear();
+}
+
+bool DatabaseWorker::isRunning() const
+{
+    return !runners.isEmpty();
+}
+
+int DatabaseWorker::threadCount() const
+{
+    return runners.size();
+}
+
+QueryRunner* DatabaseWorker::pickRunner() const
+{
+    QueryRunner* best = nullptr;
+    for (QueryRunner* runner : runners) {
+        if (!best || runner->queuedCount() < best->queuedCount()) {
+            best = runner;
+        }
+    }
+    return best;
+}
+
+int DatabaseWorker::submit(const QString& sql, const QVariantList& values)
+{
+    QueryRunner* runner = pickRunner();
+    if (!runner) {
+        qCWarning(lcModel) << "数据库工作线程未启动，无法提交查询";
+        return 0;
+    }
+
+    int ticket = nextTicket++;
+    runner->enqueue();
+    QMetaObject::invokeMethod(runner, "run", Qt::QueuedConnection,
+                              Q_ARG(int, ticket),
+                              Q_ARG(QString, sql),
+                              Q_ARG(QVariantList, values));
+    return ticket;
+}
+
+int DatabaseWorker::submit(const QString& sql, const QVariantList& values, QObject* context, Callback callback)
+{
+    int ticket = submit(sql, values);
+    if (ticket > 0) {
+        callbacks.insert(ticket, PendingCallback{QPointer<QObject>(context), callback});
+    }
+    return ticket;
+}
+
+void DatabaseWorker::cancel(int ticket)
+{
+    if (ticket <= 0) {
+        return;
+    }
+
+    callbacks.remove(ticket);
+    QMutexLocker locker(&cancelMutex);
+    cancelledTickets.insert(ticket);
+}
+
+bool DatabaseWorker::takeCancelled(int ticket)
+{
+    QMutexLocker locker(&cancelMutex);
+    return cancelledTickets.remove(ticket);
+}
+
+void DatabaseWorker::onRunnerFinished(const QueryResult& result)
+{
+    // 执行完成后才被取消的请求不再分发
+    if (takeCancelled(result.ticket)) {
+        return;
+    }
+
+    if (!result.success) {
+        qCWarning(lcSql) << "后台查询失败:" << result.error;
+    }
+
+    auto it = callbacks.find(result.ticket);
+    if (it != callbacks.end()) {
+        PendingCallback pending = it.value();
+        callbacks.erase(it);
+        if (pending.context) {
+            pending.callback(result);
+        }
+    }
+
+    emit queryFinished(result);
+}
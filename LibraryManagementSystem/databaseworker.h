@@ -0,0 +1,106 @@
+#ifndef DATABASEWORKER_H
+#define DATABASEWORKER_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QAtomicInteger>
+#include <QPointer>
+#include <functional>
+
+// 异步查询结果
+struct QueryResult
+{
+    int ticket = 0;
+    bool success = false;
+    QString error;
+    QVector<QVariantList> rows;
+};
+Q_DECLARE_METATYPE(QueryResult)
+
+// 运行在工作线程中的查询执行器，使用该线程在读连接池中的只读连接
+class QueryRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    QueryRunner() = default;
+
+    // 已提交尚未执行完的请求数，用于把新请求分给最空闲的线程
+    int queuedCount() const { return queued.loadRelaxed(); }
+    void enqueue() { queued.fetchAndAddRelaxed(1); }
+
+public slots:
+    void open();
+    void close();
+    void run(int ticket, const QString& sql, const QVariantList& values);
+
+signals:
+    void finished(const QueryResult& result);
+
+private:
+    QString connectionName;
+    QAtomicInteger<int> queued = 0;
+};
+
+// 异步数据库执行器：在若干后台线程中并行执行只读查询（每个线程一个读连接），
+// 结果通过信号或回调返回到界面线程
+class DatabaseWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void(const QueryResult&)>;
+
+    static DatabaseWorker& getInstance();
+
+    // 在DatabaseManager初始化数据库之后启动；threadCount为0时按CPU核数选择（2~4个）
+    bool start(int threadCount = 0);
+    void stop();
+    bool isRunning() const;
+    int threadCount() const;
+
+    // 提交查询，返回请求编号；结果通过queryFinished信号返回
+    int submit(const QString& sql, const QVariantList& values = QVariantList());
+
+    // 提交查询，结果返回时在界面线程调用callback（context销毁后不再回调）
+    int submit(const QString& sql, const QVariantList& values, QObject* context, Callback callback);
+
+    // 取消尚未执行的请求
+    void cancel(int ticket);
+    bool takeCancelled(int ticket);
+
+signals:
+    void queryFinished(const QueryResult& result);
+
+private slots:
+    void onRunnerFinished(const QueryResult& result);
+
+private:
+    DatabaseWorker() = default;
+    ~DatabaseWorker();
+    DatabaseWorker(const DatabaseWorker&) = delete;
+    DatabaseWorker& operator=(const DatabaseWorker&) = delete;
+
+    struct PendingCallback {
+        QPointer<QObject> context;
+        Callback callback;
+    };
+
+    QueryRunner* pickRunner() const;
+
+    QVector<QThread*> threads;
+    QVector<QueryRunner*> runners;
+    int nextTicket = 1;
+    QHash<int, PendingCallback> callbacks;
+
+    QMutex cancelMutex;
+    QSet<int> cancelledTickets;
+};
+
+#endif // DATABASEWORKER_H
@@ -0,0 +1,549 @@
+#include "dataexporter.h"
+#include "databasemanager.h"
+#include "queryprofiler.h"
+#include <QIODevice>
+#include <QSaveFile>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QHash>
+#include <QVector>
+#include <QtEndian>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+namespace {
+
+// 列式格式（小端）：
+//   文件头  "LMSC" u16版本 u32列数，每列 u8类型 + 字符串列名
+//   行组    u32行数，之后逐列：空值位图（每行1位，1为空），再按类型写值
+//             整数 行数×i64；浮点 行数×f64；文本 行数×u32结束偏移 + u32字节数 + UTF-8内容；
+//             字典 u32新增词条数 + 各词条字符串，再写 行数×u32编码（词条按首次出现顺序编号）
+//   文件尾  u32 0 + i64总行数 + "LMSC"
+//   字符串均为 u32字节数 + UTF-8内容
+const char ColumnarMagic[4] = {'L', 'M', 'S', 'C'};
+const quint16 ColumnarVersion = 1;
+
+// 取值范围很小、适合按字典编码的列
+const QStringList DictionaryColumns = {"category", "status"};
+
+enum ColumnType : quint8 {
+    IntegerColumn = 0,
+    RealColumn = 1,
+    TextColumn = 2,
+    DictionaryColumn = 3
+};
+
+struct Column {
+    QString name;
+    ColumnType type = TextColumn;
+};
+
+// 按声明类型确定列类型（与SQLite的类型亲和性规则一致）
+ColumnType columnType(const QString& name, const QString& declaredType)
+{
+    if (DictionaryColumns.contains(name)) {
+        return DictionaryColumn;
+    }
+    QString type = declaredType.toUpper();
+    if (type.contains("INT")) {
+        return IntegerColumn;
+    }
+    if (type.contains("CHAR") || type.contains("CLOB") || type.contains("TEXT")) {
+        return TextColumn;
+    }
+    if (type.contains("REAL") || type.contains("FLOA") || type.contains("DOUB") || type.contains("DEC")) {
+        return RealColumn;
+    }
+    return TextColumn;
+}
+
+bool readColumns(const QSqlDatabase& db, const QString& table, QVector<Column>* columns, QString* error)
+{
+    // 优先使用启动时读取的表结构
+    TableSchema schema = DatabaseManager::getInstance().schema().table(table);
+    if (schema.isValid()) {
+        for (int i = 0; i < schema.columns.size(); i++) {
+            Column column;
+            column.name = schema.columns.at(i);
+            column.type = columnType(column.name, schema.declaredTypes.at(i));
+            columns->append(column);
+        }
+        return true;
+    }
+
+    QSqlQuery query(db);
+    if (!query.exec(QString("PRAGMA table_info(%1)").arg(table))) {
+        *error = query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        Column column;
+        column.name = query.value(1).toString();
+        column.type = columnType(column.name, query.value(2).toString());
+        columns->append(column);
+    }
+    if (columns->isEmpty()) {
+        *error = QString("表不存在: %1").arg(table);
+        return false;
+    }
+    return true;
+}
+
+// 进度所需的总行数取自统计计数表，避免对大表执行COUNT(*)
+qint64 expectedRows(const QSqlDatabase& db, const QString& table)
+{
+    static const QHash<QString, QString> counterNames = {
+        {"books", "books"}, {"readers", "readers"}, {"borrow_records", "total_borrows"}};
+
+    QSqlQuery query(db);
+    query.prepare("SELECT value FROM stats_counters WHERE name=?");
+    query.addBindValue(counterNames.value(table));
+    return query.exec() && query.next() ? query.value(0).toLongLong() : 0;
+}
+
+void appendJsonString(QByteArray& line, const QString& value)
+{
+    line += '"';
+    const QByteArray utf8 = value.toUtf8();
+    for (char c : utf8) {
+        switch (c) {
+        case '"':  line += "\\\""; break;
+        case '\\': line += "\\\\"; break;
+        case '\n': line += "\\n"; break;
+        case '\r': line += "\\r"; break;
+        case '\t': line += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                line += QByteArray("\\u00") + QByteArray::number(static_cast<unsigned char>(c), 16).rightJustified(2, '0');
+            } else {
+                line += c;
+            }
+        }
+    }
+    line += '"';
+}
+
+template <typename T>
+void appendLittleEndian(QByteArray& buffer, T value)
+{
+    T little = qToLittleEndian(value);
+    buffer.append(reinterpret_cast<const char*>(&little), sizeof(T));
+}
+
+void appendString(QByteArray& buffer, const QString& value)
+{
+    const QByteArray utf8 = value.toUtf8();
+    appendLittleEndian<quint32>(buffer, static_cast<quint32>(utf8.size()));
+    buffer.append(utf8);
+}
+
+// 各格式的写出器：每行调用一次writeRow，缓冲区复用，不随行数增长
+class RowWriter
+{
+public:
+    explicit RowWriter(QIODevice* output) : output(output) {}
+    virtual ~RowWriter() = default;
+
+    virtual bool begin(const QVector<Column>& columns) = 0;
+    virtual bool writeRow(const QSqlQuery& query) = 0;
+    virtual bool end(qint64 rows) = 0;
+
+    QString errorString() const { return output->errorString(); }
+
+protected:
+    bool write(const QByteArray& data)
+    {
+        return output->write(data) == data.size();
+    }
+
+    QIODevice* output;
+    QVector<Column> columns;
+    QByteArray line;
+};
+
+class CsvWriter : public RowWriter
+{
+public:
+    using RowWriter::RowWriter;
+
+    bool begin(const QVector<Column>& tableColumns) override
+    {
+        columns = tableColumns;
+        QStringList header;
+        for (const Column& column : columns) {
+            header << DataExporter::csvField(column.name);
+        }
+        return write(header.join(',').toUtf8() + '\n');
+    }
+
+    bool writeRow(const QSqlQuery& query) override
+    {
+        line.resize(0);
+        for (int i = 0; i < columns.size(); i++) {
+            if (i > 0) {
+                line += ',';
+            }
+            line += DataExporter::csvField(query.value(i).toString()).toUtf8();
+        }
+        line += '\n';
+        return write(line);
+    }
+
+    bool end(qint64) override { return true; }
+};
+
+class NdjsonWriter : public RowWriter
+{
+public:
+    using RowWriter::RowWriter;
+
+    bool begin(const QVector<Column>& tableColumns) override
+    {
+        columns = tableColumns;
+        return true;
+    }
+
+    bool writeRow(const QSqlQuery& query) override
+    {
+        line.resize(0);
+        line += '{';
+        for (int i = 0; i < columns.size(); i++) {
+            if (i > 0) {
+                line += ',';
+            }
+            appendJsonString(line, columns.at(i).name);
+            line += ':';
+
+            QVariant value = query.value(i);
+            if (value.isNull()) {
+                line += "null";
+            } else if (columns.at(i).type == IntegerColumn) {
+                line += QByteArray::number(value.toLongLong());
+            } else if (columns.at(i).type == RealColumn) {
+                line += QByteArray::number(value.toDouble(), 'g', 17);
+            } else {
+                appendJsonString(line, value.toString());
+            }
+        }
+        line += "}\n";
+        return write(line);
+    }
+
+    bool end(qint64) override { return true; }
+};
+
+class ColumnarWriter : public RowWriter
+{
+public:
+    using RowWriter::RowWriter;
+
+    bool begin(const QVector<Column>& tableColumns) override
+    {
+        columns = tableColumns;
+        buffers.resize(columns.size());
+
+        line.resize(0);
+        line.append(ColumnarMagic, sizeof(ColumnarMagic));
+        appendLittleEndian<quint16>(line, ColumnarVersion);
+        appendLittleEndian<quint32>(line, static_cast<quint32>(columns.size()));
+        for (const Column& column : columns) {
+            line.append(static_cast<char>(column.type));
+            appendString(line, column.name);
+        }
+        return write(line);
+    }
+
+    bool writeRow(const QSqlQuery& query) override
+    {
+        for (int i = 0; i < columns.size(); i++) {
+            ColumnBuffer& buffer = buffers[i];
+            QVariant value = query.value(i);
+            bool isNull = value.isNull();
+            if (groupRows % 8 == 0) {
+                buffer.nulls.append('\0');
+            }
+            if (isNull) {
+                buffer.nulls.data()[groupRows / 8] |= static_cast<char>(1 << (groupRows % 8));
+            }
+
+            switch (columns.at(i).type) {
+            case IntegerColumn:
+                appendLittleEndian<qint64>(buffer.values, isNull ? 0 : value.toLongLong());
+                break;
+            case RealColumn: {
+                double real = isNull ? 0.0 : value.toDouble();
+                quint64 bits;
+                std::memcpy(&bits, &real, sizeof(bits));
+                appendLittleEndian<quint64>(buffer.values, bits);
+                break;
+            }
+            case TextColumn:
+                if (!isNull) {
+                    buffer.text += value.toString().toUtf8();
+                }
+                appendLittleEndian<quint32>(buffer.values, static_cast<quint32>(buffer.text.size()));
+                break;
+            case DictionaryColumn: {
+                quint32 code = 0;
+                if (!isNull) {
+                    QString text = value.toString();
+                    auto it = buffer.dictionary.constFind(text);
+                    if (it == buffer.dictionary.constEnd()) {
+                        code = static_cast<quint32>(buffer.dictionary.size());
+                        buffer.dictionary.insert(text, code);
+                        buffer.newEntries << text;
+                    } else {
+                        code = it.value();
+                    }
+                }
+                appendLittleEndian<quint32>(buffer.values, code);
+                break;
+            }
+            }
+        }
+
+        if (++groupRows == DataExporter::RowGroupSize) {
+            return flushGroup();
+        }
+        return true;
+    }
+
+    bool end(qint64 rows) override
+    {
+        if (groupRows > 0 && !flushGroup()) {
+            return false;
+        }
+        line.resize(0);
+        appendLittleEndian<quint32>(line, 0);
+        appendLittleEndian<qint64>(line, rows);
+        line.append(ColumnarMagic, sizeof(ColumnarMagic));
+        return write(line);
+    }
+
+private:
+    struct ColumnBuffer {
+        QByteArray nulls;
+        QByteArray values;
+        QByteArray text;
+        QHash<QString, quint32> dictionary;  // 跨行组保留，只写出新增的词条
+        QStringList newEntries;
+    };
+
+    bool flushGroup()
+    {
+        line.resize(0);
+        appendLittleEndian<quint32>(line, static_cast<quint32>(groupRows));
+        for (int i = 0; i < columns.size(); i++) {
+            ColumnBuffer& buffer = buffers[i];
+            line += buffer.nulls;
+            if (columns.at(i).type == DictionaryColumn) {
+                appendLittleEndian<quint32>(line, static_cast<quint32>(buffer.newEntries.size()));
+                for (const QString& entry : std::as_const(buffer.newEntries)) {
+                    appendString(line, entry);
+                }
+                buffer.newEntries.clear();
+            }
+            line += buffer.values;
+            if (columns.at(i).type == TextColumn) {
+                appendLittleEndian<quint32>(line, static_cast<quint32>(buffer.text.size()));
+                line += buffer.text;
+            }
+            buffer.nulls.resize(0);
+            buffer.values.resize(0);
+            buffer.text.resize(0);
+        }
+        groupRows = 0;
+        return write(line);
+    }
+
+    QVector<ColumnBuffer> buffers;
+    int groupRows = 0;
+};
+
+} // namespace
+
+DataExporter::DataExporter(QObject *parent)
+    : QObject(parent)
+{
+}
+
+DataExporter::~DataExporter()
+{
+    if (thread) {
+        cancel();
+        thread->wait();
+    }
+}
+
+bool DataExporter::start(const QString& table, Format format, const QString& filePath)
+{
+    if (isRunning() || !tables().contains(table)) {
+        return false;
+    }
+
+    cancelRequested = false;
+    thread = QThread::create([this, table, format, filePath]() {
+        Summary summary;
+        {
+            // 先写入临时文件，完整导出后才替换目标文件，取消或失败时不留下残缺的文件
+            QSaveFile file(filePath);
+            // 在读连接上导出，整个导出读取同一个快照，不阻塞界面线程的写入
+            QSqlDatabase db = DatabaseManager::getInstance().readConnection();
+            if (!file.open(QIODevice::WriteOnly)) {
+                summary.error = file.errorString();
+            } else if (!db.isOpen()) {
+                summary.error = db.lastError().text();
+            } else {
+                summary = exportTable(table, format, &file, db, &cancelRequested, [this](int percent) {
+                    emit progressChanged(percent);
+                });
+                if (summary.error.isEmpty() && !summary.cancelled && !file.commit()) {
+                    summary.error = file.errorString();
+                }
+            }
+        }
+        DatabaseManager::getInstance().releaseReadConnection();
+
+        emit finished(summary.rows, summary.cancelled, summary.error);
+    });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+    return true;
+}
+
+void DataExporter::cancel()
+{
+    cancelRequested = true;
+}
+
+bool DataExporter::isRunning() const
+{
+    return thread && thread->isRunning();
+}
+
+DataExporter::Summary DataExporter::exportTable(const QString& table, Format format, QIODevice* output,
+                                                const QSqlDatabase& db, const std::atomic_bool* cancelFlag,
+                                                const std::function<void(int)>& progress)
+{
+    Summary summary;
+    if (!tables().contains(table)) {
+        summary.error = QString("不支持导出的表: %1").arg(table);
+        return summary;
+    }
+
+    QVector<Column> columns;
+    if (!readColumns(db, table, &columns, &summary.error)) {
+        return summary;
+    }
+    const qint64 total = qMax<qint64>(1, expectedRows(db, table));
+
+    QStringList names;
+    for (const Column& column : columns) {
+        names << column.name;
+    }
+
+    // 只向前遍历，SQLite逐行返回结果，不在内存中保存结果集
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec(QString("SELECT %1 FROM %2 ORDER BY id").arg(names.join(", "), table))) {
+        summary.error = query.lastError().text();
+        return summary;
+    }
+
+    std::unique_ptr<RowWriter> writer;
+    switch (format) {
+    case Csv:
+        writer.reset(new CsvWriter(output));
+        break;
+    case Ndjson:
+        writer.reset(new NdjsonWriter(output));
+        break;
+    case Columnar:
+        writer.reset(new ColumnarWriter(output));
+        break;
+    }
+
+    if (!writer->begin(columns)) {
+        summary.error = writer->errorString();
+        return summary;
+    }
+
+    int lastPercent = -1;
+    while (query.next()) {
+        if (cancelFlag && *cancelFlag) {
+            summary.cancelled = true;
+            break;
+        }
+        if (!writer->writeRow(query)) {
+            summary.error = writer->errorString();
+            break;
+        }
+        summary.rows++;
+
+        if (progress && summary.rows % 10000 == 0) {
+            int percent = static_cast<int>(qMin<qint64>(99, summary.rows * 100 / total));
+            if (percent != lastPercent) {
+                lastPercent = percent;
+                progress(percent);
+            }
+        }
+    }
+    query.finish();
+
+    if (summary.error.isEmpty() && !summary.cancelled) {
+        if (!writer->end(summary.rows)) {
+            summary.error = writer->errorString();
+        } else if (progress) {
+            progress(100);
+        }
+    }
+
+    if (!summary.error.isEmpty()) {
+        qCWarning(lcModel) << "导出失败:" << table << summary.error;
+    }
+    return summary;
+}
+
+QStringList DataExporter::tables()
+{
+    return {"books", "readers", "borrow_records"};
+}
+
+bool DataExporter::formatFromName(const QString& name, Format* format)
+{
+    QString lower = name.toLower();
+    if (lower == "csv") {
+        *format = Csv;
+    } else if (lower == "ndjson" || lower == "json") {
+        *format = Ndjson;
+    } else if (lower == "columnar") {
+        *format = Columnar;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QString DataExporter::fileSuffix(Format format)
+{
+    switch (format) {
+    case Csv:
+        return "csv";
+    case Ndjson:
+        return "ndjson";
+    case Columnar:
+        return "lmsc";
+    }
+    return QString();
+}
+
+QString DataExporter::csvField(const QString& value)
+{
+    if (!value.contains(',') && !value.contains('"') && !value.contains('\n') && !value.contains('\r')) {
+        return value;
+    }
+    QString escaped = value;
+    escaped.replace("\"", "\"\"");
+    return "\"" + escaped + "\"";
+}
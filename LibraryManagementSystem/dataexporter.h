@@ -0,0 +1,69 @@
+#ifndef DATAEXPORTER_H
+#define DATAEXPORTER_H
+
+#include <QObject>
+#include <QThread>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QPointer>
+#include <atomic>
+#include <functional>
+
+class QIODevice;
+
+// 数据导出：只向前遍历books、readers、borrow_records，逐行写出，内存占用与表的大小无关。
+// 支持CSV、NDJSON（每行一个JSON对象）和列式二进制格式
+class DataExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Format {
+        Csv,
+        Ndjson,
+        Columnar
+    };
+
+    struct Summary {
+        qint64 rows = 0;
+        bool cancelled = false;
+        QString error;
+    };
+
+    explicit DataExporter(QObject *parent = nullptr);
+    ~DataExporter();
+
+    // 在后台线程导出到文件，进度与结果通过信号返回
+    bool start(const QString& table, Format format, const QString& filePath);
+    void cancel();
+    bool isRunning() const;
+
+    // 在当前线程导出到已打开的设备（命令行模式使用）
+    static Summary exportTable(const QString& table, Format format, QIODevice* output,
+                               const QSqlDatabase& db, const std::atomic_bool* cancelFlag = nullptr,
+                               const std::function<void(int)>& progress = nullptr);
+
+    // 可导出的表
+    static QStringList tables();
+
+    // 格式名（csv、ndjson、columnar）与文件扩展名
+    static bool formatFromName(const QString& name, Format* format);
+    static QString fileSuffix(Format format);
+
+    // CSV字段转义：包含逗号、引号或换行时加引号
+    static QString csvField(const QString& value);
+
+    // 列式格式每个行组的行数
+    static const int RowGroupSize = 65536;
+
+signals:
+    void progressChanged(int percent);
+    void finished(qint64 rows, bool cancelled, const QString& error);
+
+private:
+    QPointer<QThread> thread;
+    std::atomic_bool cancelRequested{false};
+};
+
+#endif // DATAEXPORTER_H
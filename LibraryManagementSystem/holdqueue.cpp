@@ -0,0 +1,127 @@
+#include "holdqueue.h"
+#include "queryprofiler.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDateTime>
+
+const char* HoldQueue::TimeFormat = "yyyy-MM-dd HH:mm:ss.zzz";
+
+HoldQueue& HoldQueue::getInstance()
+{
+    static HoldQueue instance;
+    return instance;
+}
+
+bool HoldQueue::load(const QSqlDatabase& db)
+{
+    clear();
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT id, book_isbn, reader_id, created, status FROM holds "
+                    "WHERE status IN ('等待', '已到书')")) {
+        qCWarning(lcModel) << "读取预约队列失败:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        Hold entry;
+        entry.id = query.value(0).toInt();
+        entry.bookIsbn = query.value(1).toString();
+        entry.readerId = query.value(2).toString();
+        entry.created = QDateTime::fromString(query.value(3).toString(), TimeFormat).toMSecsSinceEpoch();
+        entry.ready = query.value(4).toString() == "已到书";
+        added(entry);
+    }
+
+    loaded = true;
+    return true;
+}
+
+void HoldQueue::clear()
+{
+    holds.clear();
+    queues.clear();
+    byReader.clear();
+    loaded = false;
+}
+
+bool HoldQueue::isLoaded() const
+{
+    return loaded;
+}
+
+int HoldQueue::waitingCount(const QString& bookIsbn) const
+{
+    auto it = queues.constFind(bookIsbn);
+    return it != queues.constEnd() ? static_cast<int>(it->size()) : 0;
+}
+
+int HoldQueue::nextWaiting(const QString& bookIsbn, const QSet<int>& skip) const
+{
+    auto it = queues.constFind(bookIsbn);
+    if (it == queues.constEnd()) {
+        return 0;
+    }
+    // skip只包含同一批次中已分配的预约，通常为空
+    for (const QueueKey& key : *it) {
+        if (!skip.contains(key.second)) {
+            return key.second;
+        }
+    }
+    return 0;
+}
+
+int HoldQueue::activeHold(const QString& bookIsbn, const QString& readerId) const
+{
+    return byReader.value(qMakePair(bookIsbn, readerId));
+}
+
+HoldQueue::Hold HoldQueue::hold(int holdId) const
+{
+    return holds.value(holdId);
+}
+
+void HoldQueue::added(const Hold& hold)
+{
+    holds.insert(hold.id, hold);
+    byReader.insert(qMakePair(hold.bookIsbn, hold.readerId), hold.id);
+    if (!hold.ready) {
+        queues[hold.bookIsbn].insert(QueueKey(hold.created, hold.id));
+    }
+}
+
+void HoldQueue::markReady(int holdId)
+{
+    auto it = holds.find(holdId);
+    if (it == holds.end() || it->ready) {
+        return;
+    }
+    it->ready = true;
+
+    auto queue = queues.find(it->bookIsbn);
+    if (queue != queues.end()) {
+        queue->erase(QueueKey(it->created, holdId));
+        if (queue->empty()) {
+            queues.erase(queue);
+        }
+    }
+}
+
+void HoldQueue::removed(int holdId)
+{
+    auto it = holds.find(holdId);
+    if (it == holds.end()) {
+        return;
+    }
+    if (!it->ready) {
+        auto queue = queues.find(it->bookIsbn);
+        if (queue != queues.end()) {
+            queue->erase(QueueKey(it->created, holdId));
+            if (queue->empty()) {
+                queues.erase(queue);
+            }
+        }
+    }
+    byReader.remove(qMakePair(it->bookIsbn, it->readerId));
+    holds.erase(it);
+}
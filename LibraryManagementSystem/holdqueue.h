@@ -0,0 +1,64 @@
+#ifndef HOLDQUEUE_H
+#define HOLDQUEUE_H
+
+#include <QString>
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QSqlDatabase>
+#include <set>
+#include <utility>
+
+// 预约队列：holds表中仍有效（等待中、已到书）的预约的内存副本。
+// 每本书的等待队列按(预约时间, 预约ID)有序，取队首、入队和出队都是O(log n)，
+// 还书时无需查询或扫描就能知道该留给谁。
+// 首次使用时加载，之后由BorrowModel在事务提交后同步更新；只在写连接所属线程使用
+class HoldQueue
+{
+public:
+    struct Hold {
+        int id = 0;
+        QString readerId;
+        QString bookIsbn;
+        qint64 created = 0;   // 预约时间（毫秒）
+        bool ready = false;   // 已有副本为其保留
+    };
+
+    static HoldQueue& getInstance();
+
+    bool load(const QSqlDatabase& db);
+    void clear();
+    bool isLoaded() const;
+
+    // 该书等待中的预约数
+    int waitingCount(const QString& bookIsbn) const;
+
+    // 该书等待最久的预约（跳过skip中的预约），没有时返回0
+    int nextWaiting(const QString& bookIsbn, const QSet<int>& skip = QSet<int>()) const;
+
+    // 读者对该书仍有效的预约，没有时返回0
+    int activeHold(const QString& bookIsbn, const QString& readerId) const;
+    Hold hold(int holdId) const;
+
+    // 事务提交后同步：新增预约、副本已保留、预约结束（借出或取消）
+    void added(const Hold& hold);
+    void markReady(int holdId);
+    void removed(int holdId);
+
+    // holds.created列的格式，按字典序比较即按时间先后
+    static const char* TimeFormat;
+
+private:
+    HoldQueue() = default;
+    HoldQueue(const HoldQueue&) = delete;
+    HoldQueue& operator=(const HoldQueue&) = delete;
+
+    using QueueKey = std::pair<qint64, int>;
+
+    bool loaded = false;
+    QHash<int, Hold> holds;
+    QHash<QString, std::set<QueueKey>> queues;     // ISBN -> 等待中的预约
+    QHash<QPair<QString, QString>, int> byReader;  // (ISBN, 读者编号) -> 预约ID
+};
+
+#endif // HOLDQUEUE_H
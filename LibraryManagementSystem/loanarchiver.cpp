@@ -0,0 +1,150 @@
+#include "loanarchiver.h"
+#include "databasemanager.h"
+#include "queryprofiler.h"
+#include <QSqlQuery>
+#include <QSqlError>
+
+LoanArchiver::LoanArchiver(QObject *parent)
+    : QObject(parent)
+{
+}
+
+LoanArchiver::~LoanArchiver()
+{
+    if (thread) {
+        cancel();
+        thread->wait();
+    }
+}
+
+bool LoanArchiver::start(int horizonDays)
+{
+    if (isRunning() || horizonDays < 0) {
+        return false;
+    }
+
+    cancelRequested = false;
+    QString dbPath = DatabaseManager::getInstance().databasePath();
+    QDate cutoff = QDate::currentDate().addDays(-horizonDays);
+
+    thread = QThread::create([this, dbPath, cutoff]() {
+        // 与批量导入一样使用独立的写连接，界面线程的写连接只在批次之间等待写锁
+        const QString connectionName = "library_archive";
+        Summary summary;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+            db.setDatabaseName(dbPath);
+            if (db.open()) {
+                DatabaseManager::getInstance().profile().apply(db);
+                summary = archive(db, cutoff, &cancelRequested, [this](qint64 archived) {
+                    emit progressChanged(archived);
+                });
+                db.close();
+            } else {
+                summary.error = db.lastError().text();
+            }
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+
+        emit finished(summary.archived, summary.cancelled, summary.error);
+    });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+    return true;
+}
+
+void LoanArchiver::cancel()
+{
+    cancelRequested = true;
+}
+
+bool LoanArchiver::isRunning() const
+{
+    return thread && thread->isRunning();
+}
+
+LoanArchiver::Summary LoanArchiver::archive(const QSqlDatabase& db, const QDate& cutoff,
+                                            const std::atomic_bool* cancelFlag,
+                                            const std::function<void(qint64)>& progress)
+{
+    Summary summary;
+    QString cutoffDate = cutoff.toString("yyyy-MM-dd");
+    QString archivedDate = QDate::currentDate().toString("yyyy-MM-dd");
+    qint64 lastId = 0;
+
+    // 每批先确定主键上界，复制和删除使用同一个范围与条件，两条语句在同一事务中看到相同的行
+    const QString condition = "id > ? AND id <= ? AND status = '已归还' AND return_date < ?";
+    QSqlQuery transaction(db);
+    QSqlQuery boundQuery(db);
+    boundQuery.prepare("SELECT MAX(id) FROM (SELECT id FROM borrow_records "
+                       "WHERE id > ? AND status = '已归还' AND return_date < ? ORDER BY id LIMIT ?)");
+    QSqlQuery copyQuery(db);
+    copyQuery.prepare("INSERT INTO borrow_records_archive "
+                      "(id, reader_id, book_isbn, borrow_date, due_date, return_date, status, fine_amount, archived_date) "
+                      "SELECT id, reader_id, book_isbn, borrow_date, due_date, return_date, status, fine_amount, ? "
+                      "FROM borrow_records WHERE " + condition);
+    QSqlQuery deleteQuery(db);
+    deleteQuery.prepare("DELETE FROM borrow_records WHERE " + condition);
+
+    for (;;) {
+        if (cancelFlag && *cancelFlag) {
+            summary.cancelled = true;
+            break;
+        }
+
+        if (!transaction.exec("BEGIN IMMEDIATE")) {
+            summary.error = transaction.lastError().text();
+            break;
+        }
+
+        boundQuery.addBindValue(lastId);
+        boundQuery.addBindValue(cutoffDate);
+        boundQuery.addBindValue(BatchSize);
+        if (!boundQuery.exec() || !boundQuery.next()) {
+            summary.error = boundQuery.lastError().text();
+            transaction.exec("ROLLBACK");
+            break;
+        }
+        QVariant bound = boundQuery.value(0);
+        boundQuery.finish();
+        if (bound.isNull()) {
+            // 没有更多需要归档的记录
+            transaction.exec("ROLLBACK");
+            break;
+        }
+        qint64 upperId = bound.toLongLong();
+
+        copyQuery.addBindValue(archivedDate);
+        copyQuery.addBindValue(lastId);
+        copyQuery.addBindValue(upperId);
+        copyQuery.addBindValue(cutoffDate);
+        deleteQuery.addBindValue(lastId);
+        deleteQuery.addBindValue(upperId);
+        deleteQuery.addBindValue(cutoffDate);
+        if (!copyQuery.exec() || !deleteQuery.exec()) {
+            summary.error = copyQuery.lastError().isValid() ? copyQuery.lastError().text()
+                                                            : deleteQuery.lastError().text();
+            transaction.exec("ROLLBACK");
+            break;
+        }
+        int moved = deleteQuery.numRowsAffected();
+        if (!transaction.exec("COMMIT")) {
+            summary.error = transaction.lastError().text();
+            transaction.exec("ROLLBACK");
+            break;
+        }
+
+        summary.archived += moved;
+        lastId = upperId;
+        if (progress) {
+            progress(summary.archived);
+        }
+    }
+
+    if (!summary.error.isEmpty()) {
+        qCWarning(lcModel) << "归档借阅记录失败:" << summary.error;
+    } else if (summary.archived > 0) {
+        qCInfo(lcModel) << "已归档借阅记录:" << summary.archived << "条，归还日期早于" << cutoffDate;
+    }
+    return summary;
+}
@@ -0,0 +1,54 @@
+#ifndef LOANARCHIVER_H
+#define LOANARCHIVER_H
+
+#include <QObject>
+#include <QThread>
+#include <QSqlDatabase>
+#include <QString>
+#include <QDate>
+#include <QPointer>
+#include <atomic>
+#include <functional>
+
+// 借阅记录归档：把归还日期早于期限的记录从borrow_records移到borrow_records_archive。
+// 按主键顺序分批，每批在一个短事务中复制并删除，批次之间释放写锁，借还书不会长时间等待
+class LoanArchiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Summary {
+        qint64 archived = 0;
+        bool cancelled = false;
+        QString error;
+    };
+
+    explicit LoanArchiver(QObject *parent = nullptr);
+    ~LoanArchiver();
+
+    // 在后台线程的独立写连接上归档归还满horizonDays天的记录，进度与结果通过信号返回
+    bool start(int horizonDays = DefaultHorizonDays);
+    void cancel();
+    bool isRunning() const;
+
+    // 在当前线程归档return_date早于cutoff的记录（命令行模式使用）
+    static Summary archive(const QSqlDatabase& db, const QDate& cutoff,
+                           const std::atomic_bool* cancelFlag = nullptr,
+                           const std::function<void(qint64)>& progress = nullptr);
+
+    // 默认保留最近一年内归还的记录
+    static const int DefaultHorizonDays = 365;
+
+    // 每个事务移动的行数
+    static const int BatchSize = 5000;
+
+signals:
+    void progressChanged(qint64 archived);
+    void finished(qint64 archived, bool cancelled, const QString& error);
+
+private:
+    QPointer<QThread> thread;
+    std::atomic_bool cancelRequested{false};
+};
+
+#endif // LOANARCHIVER_H
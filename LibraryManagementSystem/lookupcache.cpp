@@ -0,0 +1,237 @@
+#include "lookupcache.h"
+#include "databasemanager.h"
+#include "queryprofiler.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <utility>
+
+LookupCache& LookupCache::getInstance()
+{
+    static LookupCache instance;
+    return instance;
+}
+
+LookupCache::~LookupCache()
+{
+    for (const QPointer<QThread>& loader : std::as_const(loaders)) {
+        if (loader) {
+            loader->wait();
+        }
+    }
+}
+
+bool LookupCache::readTables(const QSqlDatabase& db, Tables* tables)
+{
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+
+    // 先取行数预留容量，避免加载过程中反复扩容
+    if (query.exec("SELECT (SELECT COUNT(*) FROM books), (SELECT COUNT(*) FROM readers)") && query.next()) {
+        tables->books.reserve(query.value(0).toInt());
+    }
+    query.finish();
+
+    if (!query.exec("SELECT isbn, id, available_copies, total_copies FROM books")) {
+        qCWarning(lcModel) << "加载图书索引失败:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        BookEntry entry;
+        entry.bookId = query.value(1).toInt();
+        entry.availableCopies = query.value(2).toInt();
+        entry.totalCopies = query.value(3).toInt();
+        tables->books.insert(query.value(0).toString(), entry);
+    }
+    query.finish();
+
+    if (!query.exec("SELECT reader_id, id FROM readers")) {
+        qCWarning(lcModel) << "加载读者索引失败:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        tables->readers.insert(query.value(0).toString(), query.value(1).toInt());
+    }
+    query.finish();
+    return true;
+}
+
+bool LookupCache::load(const QSqlDatabase& db)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Tables loadedTables;
+    if (!readTables(db, &loadedTables)) {
+        return false;
+    }
+
+    QMutexLocker locker(&mutex);
+    generation++;
+    tables = std::move(loadedTables);
+    journal.clear();
+    loading = false;
+    loaded = true;
+    qCInfo(lcModel) << "查找索引加载完成: 图书" << tables.books.size() << "读者" << tables.readers.size()
+             << "耗时" << timer.elapsed() << "毫秒";
+    return true;
+}
+
+void LookupCache::loadAsync()
+{
+    int ticket = 0;
+    {
+        QMutexLocker locker(&mutex);
+        // 加载完成前回退到数据库查询；仍在进行的上一次加载作废
+        ticket = ++generation;
+        loading = true;
+        loaded = false;
+        tables = Tables();
+        journal.clear();
+    }
+
+    QThread *loader = QThread::create([this, ticket]() {
+        Tables loadedTables;
+        bool success = false;
+        {
+            QSqlDatabase db = DatabaseManager::getInstance().readConnection();
+            if (db.isOpen()) {
+                success = readTables(db, &loadedTables);
+            } else {
+                qCWarning(lcModel) << "查找索引无法打开数据库:" << db.lastError().text();
+            }
+        }
+        DatabaseManager::getInstance().releaseReadConnection();
+
+        QMutexLocker locker(&mutex);
+        if (ticket != generation) {
+            return;
+        }
+        if (success) {
+            // 重放加载期间的写入
+            tables = std::move(loadedTables);
+            for (const auto& change : std::as_const(journal)) {
+                change(tables);
+            }
+            loaded = true;
+            qCInfo(lcModel) << "查找索引加载完成: 图书" << tables.books.size() << "读者" << tables.readers.size();
+        }
+        journal.clear();
+        loading = false;
+    });
+    QObject::connect(loader, &QThread::finished, loader, &QObject::deleteLater);
+    loaders.removeAll(nullptr);
+    loaders.append(loader);
+    loader->start();
+}
+
+bool LookupCache::isLoaded() const
+{
+    QMutexLocker locker(&mutex);
+    return loaded;
+}
+
+void LookupCache::clear()
+{
+    QMutexLocker locker(&mutex);
+    generation++;
+    tables = Tables();
+    loaded = false;
+    loading = false;
+    journal.clear();
+}
+
+LookupCache::Answer LookupCache::findBook(const QString& isbn, BookEntry* entry)
+{
+    QMutexLocker locker(&mutex);
+    if (!loaded) {
+        fallbacks.fetchAndAddRelaxed(1);
+        return Unknown;
+    }
+
+    const BookEntry* found = tables.books.find(isbn);
+    if (!found) {
+        negatives.fetchAndAddRelaxed(1);
+        return Absent;
+    }
+    hits.fetchAndAddRelaxed(1);
+    if (entry) {
+        *entry = *found;
+    }
+    return Found;
+}
+
+LookupCache::Answer LookupCache::findReader(const QString& readerId, int* rowId)
+{
+    QMutexLocker locker(&mutex);
+    if (!loaded) {
+        fallbacks.fetchAndAddRelaxed(1);
+        return Unknown;
+    }
+
+    const int* found = tables.readers.find(readerId);
+    if (!found) {
+        negatives.fetchAndAddRelaxed(1);
+        return Absent;
+    }
+    hits.fetchAndAddRelaxed(1);
+    if (rowId) {
+        *rowId = *found;
+    }
+    return Found;
+}
+
+void LookupCache::apply(const std::function<void(Tables&)>& change)
+{
+    QMutexLocker locker(&mutex);
+    if (loaded) {
+        change(tables);
+    } else if (loading) {
+        journal.append(change);
+    }
+}
+
+void LookupCache::putBook(const QString& isbn, const BookEntry& entry)
+{
+    apply([isbn, entry](Tables& t) { t.books.insert(isbn, entry); });
+}
+
+void LookupCache::setAvailableCopies(const QString& isbn, int availableCopies)
+{
+    apply([isbn, availableCopies](Tables& t) {
+        const BookEntry* found = t.books.find(isbn);
+        if (found) {
+            BookEntry entry = *found;
+            entry.availableCopies = availableCopies;
+            t.books.insert(isbn, entry);
+        }
+    });
+}
+
+void LookupCache::removeBook(const QString& isbn)
+{
+    apply([isbn](Tables& t) { t.books.remove(isbn); });
+}
+
+void LookupCache::putReader(const QString& readerId, int rowId)
+{
+    apply([readerId, rowId](Tables& t) { t.readers.insert(readerId, rowId); });
+}
+
+void LookupCache::removeReader(const QString& readerId)
+{
+    apply([readerId](Tables& t) { t.readers.remove(readerId); });
+}
+
+LookupCache::Stats LookupCache::stats() const
+{
+    QMutexLocker locker(&mutex);
+    Stats result;
+    result.hits = hits.loadRelaxed();
+    result.negatives = negatives.loadRelaxed();
+    result.fallbacks = fallbacks.loadRelaxed();
+    result.books = tables.books.size();
+    result.readers = tables.readers.size();
+    result.loaded = loaded;
+    return result;
+}
@@ -0,0 +1,281 @@
+#ifndef LOOKUPCACHE_H
+#define LOOKUPCACHE_H
+
+#include <QString>
+#include <QVector>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QAtomicInteger>
+#include <QThread>
+#include <QPointer>
+#include <functional>
+#include <vector>
+
+// 开放寻址哈希表（线性探测），槽位连续存放，删除时留下墓碑
+template <typename Key, typename Value>
+class OpenAddressingMap
+{
+public:
+    int size() const { return count; }
+
+    void clear()
+    {
+        slots.clear();
+        count = 0;
+        used = 0;
+    }
+
+    void reserve(int entries)
+    {
+        int capacity = 16;
+        while (capacity * 7 / 10 < entries) {
+            capacity *= 2;
+        }
+        if (static_cast<size_t>(capacity) > slots.size()) {
+            rehash(capacity);
+        }
+    }
+
+    const Value* find(const Key& key) const
+    {
+        if (slots.empty()) {
+            return nullptr;
+        }
+        const size_t mask = slots.size() - 1;
+        for (size_t i = hashKey(key) & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots[i];
+            if (slot.state == Empty) {
+                return nullptr;
+            }
+            if (slot.state == Occupied && slot.key == key) {
+                return &slot.value;
+            }
+        }
+    }
+
+    void insert(const Key& key, const Value& value)
+    {
+        // 装载因子（含墓碑）不超过0.7
+        if ((used + 1) * 10 > static_cast<int>(slots.size()) * 7) {
+            rehash(slots.empty() ? 16 : (count + 1) * 10 > static_cast<int>(slots.size()) * 5
+                                            ? static_cast<int>(slots.size()) * 2
+                                            : static_cast<int>(slots.size()));
+        }
+
+        const size_t mask = slots.size() - 1;
+        Slot* tombstone = nullptr;
+        for (size_t i = hashKey(key) & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            if (slot.state == Occupied && slot.key == key) {
+                slot.value = value;
+                return;
+            }
+            if (slot.state == Deleted && !tombstone) {
+                tombstone = &slot;
+            }
+            if (slot.state == Empty) {
+                Slot& target = tombstone ? *tombstone : slot;
+                if (!tombstone) {
+                    used++;
+                }
+                target.key = key;
+                target.value = value;
+                target.state = Occupied;
+                count++;
+                return;
+            }
+        }
+    }
+
+    bool remove(const Key& key)
+    {
+        if (slots.empty()) {
+            return false;
+        }
+        const size_t mask = slots.size() - 1;
+        for (size_t i = hashKey(key) & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            if (slot.state == Empty) {
+                return false;
+            }
+            if (slot.state == Occupied && slot.key == key) {
+                slot.state = Deleted;
+                slot.key = Key();
+                count--;
+                return true;
+            }
+        }
+    }
+
+private:
+    enum State : quint8 { Empty, Occupied, Deleted };
+    struct Slot {
+        Key key = Key();
+        Value value = Value();
+        State state = Empty;
+    };
+
+    static size_t hashKey(quint64 key)
+    {
+        // splitmix64的混合函数，连续的编号也能均匀分布
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ULL;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebULL;
+        key ^= key >> 31;
+        return static_cast<size_t>(key);
+    }
+    static size_t hashKey(const QString& key)
+    {
+        return static_cast<size_t>(qHash(key));
+    }
+
+    void rehash(int capacity)
+    {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.resize(capacity);
+        count = 0;
+        used = 0;
+        for (Slot& slot : old) {
+            if (slot.state == Occupied) {
+                insert(slot.key, slot.value);
+            }
+        }
+    }
+
+    std::vector<Slot> slots;
+    int count = 0;  // 有效条目
+    int used = 0;   // 有效条目 + 墓碑
+};
+
+// 以字符串为键的紧凑映射：不超过17位的纯数字键（如ISBN-13）压缩为64位整数存放，
+// 其余的键按字符串存放
+template <typename Value>
+class CompactKeyMap
+{
+public:
+    int size() const { return numeric.size() + text.size(); }
+    void clear() { numeric.clear(); text.clear(); }
+    void reserve(int entries) { numeric.reserve(entries); }
+
+    const Value* find(const QString& key) const
+    {
+        quint64 packed = 0;
+        return pack(key, &packed) ? numeric.find(packed) : text.find(key);
+    }
+    void insert(const QString& key, const Value& value)
+    {
+        quint64 packed = 0;
+        if (pack(key, &packed)) {
+            numeric.insert(packed, value);
+        } else {
+            text.insert(key, value);
+        }
+    }
+    bool remove(const QString& key)
+    {
+        quint64 packed = 0;
+        return pack(key, &packed) ? numeric.remove(packed) : text.remove(key);
+    }
+
+private:
+    // 数值*32 + 长度，保留前导零（"0123"与"123"是不同的键）
+    static bool pack(const QString& key, quint64* packed)
+    {
+        if (key.isEmpty() || key.size() > 17) {
+            return false;
+        }
+        quint64 value = 0;
+        for (QChar c : key) {
+            if (c < QLatin1Char('0') || c > QLatin1Char('9')) {
+                return false;
+            }
+            value = value * 10 + (c.unicode() - '0');
+        }
+        *packed = value * 32 + static_cast<quint64>(key.size());
+        return true;
+    }
+
+    OpenAddressingMap<quint64, Value> numeric;
+    OpenAddressingMap<QString, Value> text;
+};
+
+// ISBN与读者编号的内存索引：启动时整表加载，之后由各模型的增删改同步更新（写穿），
+// 存在性和可借册数检查不再访问数据库。
+// 只反映本进程的写入；其他进程或独立连接（批量导入）写入后需要重新加载。
+class LookupCache
+{
+public:
+    struct BookEntry {
+        int bookId = 0;
+        int availableCopies = 0;
+        int totalCopies = 0;
+    };
+
+    // 查询结果：已加载时不存在也是确定的答案；未加载时为Unknown，调用方应回退到数据库
+    enum Answer { Unknown, Found, Absent };
+
+    struct Stats {
+        quint64 hits;       // 在内存中找到
+        quint64 negatives;  // 在内存中确定不存在
+        quint64 fallbacks;  // 未加载，需要查询数据库
+        int books;
+        int readers;
+        bool loaded;
+    };
+
+    static LookupCache& getInstance();
+
+    // 在调用线程中整表加载（命令行模式使用）
+    bool load(const QSqlDatabase& db);
+
+    // 在后台线程用读连接池中的连接加载当前数据库，加载期间的写穿更新在完成后重放
+    void loadAsync();
+
+    bool isLoaded() const;
+    void clear();
+
+    Answer findBook(const QString& isbn, BookEntry* entry = nullptr);
+    Answer findReader(const QString& readerId, int* rowId = nullptr);
+
+    // 写穿更新：均为设置绝对值，加载期间记下的更新按原顺序重放后与最后一次写入一致
+    void putBook(const QString& isbn, const BookEntry& entry);
+    void setAvailableCopies(const QString& isbn, int availableCopies);
+    void removeBook(const QString& isbn);
+    void putReader(const QString& readerId, int rowId);
+    void removeReader(const QString& readerId);
+
+    Stats stats() const;
+
+private:
+    LookupCache() = default;
+    ~LookupCache();
+    LookupCache(const LookupCache&) = delete;
+    LookupCache& operator=(const LookupCache&) = delete;
+
+    struct Tables {
+        CompactKeyMap<BookEntry> books;
+        CompactKeyMap<int> readers;
+    };
+    static bool readTables(const QSqlDatabase& db, Tables* tables);
+
+    // 已加载时直接修改；正在加载时同时记入日志，加载完成后重放
+    void apply(const std::function<void(Tables&)>& change);
+
+    mutable QMutex mutex;
+    Tables tables;
+    bool loaded = false;
+    bool loading = false;
+    int generation = 0;  // 每次加载或清空递增，过期的后台加载结果直接丢弃
+    QVector<std::function<void(Tables&)>> journal;
+    QList<QPointer<QThread>> loaders;
+
+    QAtomicInteger<quint64> hits = 0;
+    QAtomicInteger<quint64> negatives = 0;
+    QAtomicInteger<quint64> fallbacks = 0;
+};
+
+#endif // LOOKUPCACHE_H
@@ -1,11 +1,51 @@
 #include "mainwindow.h"
+#include "databasemanager.h"
+#include "databaseworker.h"
+#include "circulationcli.h"
+#include "databasebackup.h"
 
 #include <QApplication>
+#include <QCoreApplication>
+#include <QMessageBox>
+
+// 界面模式未指定--db时使用的数据库文件
+static const char* DefaultDatabasePath = "E:\\Qt_project\\Qt_homework\\LibraryDB\\library.db";
 
 int main(int argc, char *argv[])
 {
+    // 带子命令时以无界面模式运行，不初始化任何窗口组件
+    if (CirculationCli::isCommand(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        DatabaseManager::getInstance().setProfile(SqliteProfile::load(app.arguments()));
+        return CirculationCli::run(app.arguments());
+    }
+    
     QApplication a(argc, argv);
-    MainWindow w;
-    w.show();
-    return a.exec();
+    
+    // SQLite性能参数：配置文件[sqlite]分组，可用--pragma key=value覆盖
+    DatabaseManager::getInstance().setProfile(SqliteProfile::load(a.arguments()));
+    
+    QString dbPath = CirculationCli::databasePath(a.arguments(), QString::fromLatin1(DefaultDatabasePath));
+    int exitCode = 0;
+    for (;;) {
+        {
+            MainWindow w(dbPath);
+            w.show();
+            exitCode = a.exec();
+        }
+        
+        // 从备份恢复：窗口关闭后停止后台查询线程并关闭数据库，替换文件后重新打开窗口
+        QString snapshotPath = DatabaseBackup::takePendingRestore();
+        if (snapshotPath.isEmpty()) {
+            break;
+        }
+        DatabaseWorker::getInstance().stop();
+        DatabaseManager::getInstance().closeDatabase();
+        QString error;
+        // 快照在选择时已完整检查过
+        if (!DatabaseBackup::restoreSnapshot(snapshotPath, dbPath, &error, true)) {
+            QMessageBox::critical(nullptr, "恢复失败", error + "\n\n将继续使用原数据库。");
+        }
+    }
+    return exitCode;
 }
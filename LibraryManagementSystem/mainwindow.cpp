@@ -2,49 +2,100 @@
 #include "ui_mainwindow.h"
 #include <QHeaderView>
 #include <QDate>
-#include <QSqlQuery>
 #include <QDialog>
 #include <QDialogButtonBox>
 #include <QFormLayout>
-#include <QSet>
+#include <QFileDialog>
+#include <QProgressDialog>
+#include <QPlainTextEdit>
+#include <QListWidget>
+#include <QCheckBox>
+#include <QFontDatabase>
+#include <QApplication>
+#include <QDir>
+#include <QFileInfo>
+#include "queryprofiler.h"
 
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(const QString& dbPath, QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , bookModel(nullptr)
     , readerModel(nullptr)
+    , readerLoansModel(nullptr)
     , borrowModel(nullptr)
-    , overdueTimer(new QTimer(this))
+    , overdueScheduler(new OverdueScheduler(this))
+    , bookImporter(new BookImporter(this))
+    , dataExporter(new DataExporter(this))
+    , databaseBackup(new DatabaseBackup(this))
+    , loanArchiver(new LoanArchiver(this))
+    , bookSearch(nullptr)
+    , readerSearch(nullptr)
+    , borrowSearch(nullptr)
     , currentBookId(-1)
     , currentReaderId(-1)
     , currentBorrowId(-1)
 {
     ui->setupUi(this);
     
-    // 初始化数据库
-    QString dbPath = "E:\\Qt_project\\Qt_homework\\LibraryDB\\library.db";
+    // 初始化数据库（路径由命令行--db指定）
     if (!DatabaseManager::getInstance().initializeDatabase(dbPath)) {
         QMessageBox::critical(this, "错误", "数据库初始化失败！");
         return;
     }
     
+    // 启动后台查询线程，统计等耗时查询不再阻塞界面
+    DatabaseWorker::getInstance().start();
+    
+    // 后台加载ISBN与读者编号索引，加载完成前存在性检查仍查询数据库
+    LookupCache::getInstance().loadAsync();
+    
+    // 预约队列只包含仍有效的预约，数据量小，直接加载；预约对话框和借书提示都读取它
+    HoldQueue::getInstance().load(DatabaseManager::getInstance().getDatabase());
+    
     // 创建模型
     QSqlDatabase db = DatabaseManager::getInstance().getDatabase();
     bookModel = new BookModel(this, db);
     readerModel = new ReaderModel(this, db);
+    readerLoansModel = new ReaderLoansModel(this);
     borrowModel = new BorrowModel(this, db);
     
+    // 分类字典随图书增删改增量更新，下拉框只插入或移除变化的分类
+    CategoryDictionary& categories = CategoryDictionary::getInstance();
+    categories.load(db);
+    connect(&categories, &CategoryDictionary::categoryAdded, this, &MainWindow::onCategoryAdded);
+    connect(&categories, &CategoryDictionary::categoryRemoved, this, &MainWindow::onCategoryRemoved);
+    connect(&categories, &CategoryDictionary::reset, this, &MainWindow::loadBookCategories);
+    
     // 设置UI
     setupUI();
     
-    // 设置定时器检查逾期（每小时检查一次）
-    connect(overdueTimer, &QTimer::timeout, this, &MainWindow::checkOverdueBooks);
-    overdueTimer->start(3600000); // 1小时 = 3600000毫秒
-    checkOverdueBooks(); // 启动时立即检查一次
+    // 逾期调度：启动时加载一次未归还记录，之后随借书/还书增量更新，
+    // 只在最近的应还日期过去时触发
+    connect(borrowModel, &BorrowModel::loanOpened, this,
+            [this](int recordId, const QString& readerId, const QString&, const QDate& dueDate) {
+                overdueScheduler->addLoan(recordId, dueDate);
+                readerLoansModel->invalidate(readerId);
+            });
+    connect(borrowModel, &BorrowModel::loanClosed, this,
+            [this](int recordId, const QString& readerId, const QString&) {
+                overdueScheduler->removeLoan(recordId);
+                readerLoansModel->invalidate(readerId);
+            });
+    connect(overdueScheduler, &OverdueScheduler::loaded, this, &MainWindow::checkOverdueBooks);
+    connect(overdueScheduler, &OverdueScheduler::loaded, this, &MainWindow::refreshStatistics);
+    connect(overdueScheduler, &OverdueScheduler::recordsOverdue, borrowModel, &BorrowModel::markOverdue);
+    connect(overdueScheduler, &OverdueScheduler::recordsOverdue, this, &MainWindow::onRecordsOverdue);
+    overdueScheduler->load();
+    
+    // 定时快照：配置文件[backup]分组的interval_hours大于0时启用
+    connect(databaseBackup, &DatabaseBackup::finished, this, &MainWindow::onBackupFinished);
+    databaseBackup->setSchedule(DatabaseBackup::Schedule::load(QCoreApplication::arguments()));
 }
 
 MainWindow::~MainWindow()
 {
+    // 缓存的语句需在连接仍然有效时释放
+    DatabaseManager::getInstance().clearStatementCache();
     delete ui;
 }
 
@@ -63,27 +114,29 @@ void MainWindow::setupUI()
 void MainWindow::setupBookTab()
 {
     // 连接信号
-    connect(ui->bookSearchEdit, &QLineEdit::textChanged, this, &MainWindow::onSearchBooks);
-    connect(ui->bookCategoryCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), 
-            this, &MainWindow::onSearchBooks);
+    // 检索框输入停顿后才查询；分类变化时立即查询
+    bookSearch = new SearchController(ui->bookSearchEdit, bookModel,
+                                      [this](const QString& keyword) { onSearchBooks(keyword); }, this);
+    connect(ui->bookCategoryCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            bookSearch, &SearchController::refresh);
     connect(ui->bookAddBtn, &QPushButton::clicked, this, [this]() { showBookDialog(false); });
     connect(ui->bookEditBtn, &QPushButton::clicked, this, [this]() { showBookDialog(true); });
     connect(ui->bookDeleteBtn, &QPushButton::clicked, this, &MainWindow::onDeleteBook);
+    connect(ui->importBooksAction, &QAction::triggered, this, &MainWindow::onImportBooks);
     
     // 设置表格模型
     ui->bookTableView->setModel(bookModel);
     ui->bookTableView->horizontalHeader()->setStretchLastSection(true);
-    ui->bookTableView->setColumnWidth(0, 50);
-    ui->bookTableView->setColumnWidth(1, 120);
-    ui->bookTableView->setColumnWidth(2, 200);
-    // 隐藏不需要显示的列：total_copies(7)、available_copies(8)，以及可能的stock和status字段
-    ui->bookTableView->setColumnHidden(7, true);  // total_copies (stock)
-    ui->bookTableView->setColumnHidden(8, true);  // available_copies
-    // 检查并隐藏其他可能的字段
-    for (int i = 0; i < bookModel->columnCount(); i++) {
-        QString header = bookModel->headerData(i, Qt::Horizontal).toString().toLower();
-        if (header.contains("stock") || header.contains("status")) {
-            ui->bookTableView->setColumnHidden(i, true);
+    // 固定行高，行数很多时视图无需逐行计算高度
+    ui->bookTableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->bookTableView->setColumnWidth(bookModel->fieldIndex("id"), 50);
+    ui->bookTableView->setColumnWidth(bookModel->fieldIndex("isbn"), 120);
+    ui->bookTableView->setColumnWidth(bookModel->fieldIndex("title"), 200);
+    // 隐藏不需要显示的列（按字段名，旧版数据库中不存在的列跳过）
+    for (const char* field : {"total_copies", "available_copies", "category_id", "stock", "status"}) {
+        int column = bookModel->fieldIndex(field);
+        if (column >= 0) {
+            ui->bookTableView->setColumnHidden(column, true);
         }
     }
     connect(ui->bookTableView, &QTableView::doubleClicked, this, [this]() { showBookDialog(true); });
@@ -100,7 +153,8 @@ void MainWindow::setupBookTab()
 void MainWindow::setupReaderTab()
 {
     // 连接信号
-    connect(ui->readerSearchEdit, &QLineEdit::textChanged, this, &MainWindow::onSearchReaders);
+    readerSearch = new SearchController(ui->readerSearchEdit, readerModel,
+                                        [this](const QString& keyword) { onSearchReaders(keyword); }, this);
     connect(ui->readerAddBtn, &QPushButton::clicked, this, [this]() { showReaderDialog(false); });
     connect(ui->readerEditBtn, &QPushButton::clicked, this, [this]() { showReaderDialog(true); });
     connect(ui->readerDeleteBtn, &QPushButton::clicked, this, &MainWindow::onDeleteReader);
@@ -108,32 +162,46 @@ void MainWindow::setupReaderTab()
     // 设置表格模型
     ui->readerTableView->setModel(readerModel);
     ui->readerTableView->horizontalHeader()->setStretchLastSection(true);
-    // 隐藏不需要显示的列：地址(6)、状态(8)、update_time、create_time
-    ui->readerTableView->setColumnHidden(6, true);  // 地址
-    ui->readerTableView->setColumnHidden(7, true);  //注册时间
-    ui->readerTableView->setColumnHidden(8, true);  // 状态
-    // 检查并隐藏update_time和create_time列
-    for (int i = 0; i < readerModel->columnCount(); i++) {
-        QString header = readerModel->headerData(i, Qt::Horizontal).toString().toLower();
-        if (header.contains("update_time") || header.contains("create_time")) {
-            ui->readerTableView->setColumnHidden(i, true);
+    // 固定行高，行数很多时视图无需逐行计算高度
+    ui->readerTableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    // 隐藏不需要显示的列（按字段名，旧版数据库中不存在的列跳过）
+    for (const char* field : {"address", "register_date", "status", "create_time", "update_time"}) {
+        int column = readerModel->fieldIndex(field);
+        if (column >= 0) {
+            ui->readerTableView->setColumnHidden(column, true);
         }
     }
     connect(ui->readerTableView, &QTableView::doubleClicked, this, [this]() { showReaderDialog(true); });
     connect(ui->readerTableView->selectionModel(), &QItemSelectionModel::selectionChanged,
             this, &MainWindow::onReaderSelectionChanged);
+    
+    // 读者借阅面板：选中读者后显示其当前借出和历史借阅（滚动到底部时继续读取）
+    ui->readerLoansView->setModel(readerLoansModel);
+    ui->readerLoansView->horizontalHeader()->setStretchLastSection(true);
+    ui->readerLoansView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->readerLoansView->setColumnHidden(ReaderLoansModel::IdColumn, true);
+    ui->readerSplitter->setStretchFactor(0, 3);
+    ui->readerSplitter->setStretchFactor(1, 2);
+    connect(readerLoansModel, &ReaderLoansModel::loaded, this, &MainWindow::onReaderLoansLoaded);
 }
 
 void MainWindow::setupBorrowTab()
 {
     // 连接信号
-    connect(ui->borrowSearchEdit, &QLineEdit::textChanged, this, &MainWindow::onSearchBorrowRecords);
+    borrowSearch = new SearchController(ui->borrowSearchEdit, borrowModel,
+                                        [this](const QString& keyword) { onSearchBorrowRecords(keyword); }, this);
     connect(ui->borrowBookBtn, &QPushButton::clicked, this, &MainWindow::showBorrowDialog);
     connect(ui->returnBookBtn, &QPushButton::clicked, this, &MainWindow::onReturnBook);
+    connect(ui->scanReturnBtn, &QPushButton::clicked, this, &MainWindow::onScanReturn);
+    connect(ui->holdBtn, &QPushButton::clicked, this, &MainWindow::showHoldDialog);
+    connect(ui->showArchiveCheck, &QCheckBox::toggled, this, &MainWindow::onShowArchiveToggled);
+    connect(ui->archiveLoansAction, &QAction::triggered, this, &MainWindow::onArchiveLoans);
     
     // 设置表格模型
     ui->borrowTableView->setModel(borrowModel);
     ui->borrowTableView->horizontalHeader()->setStretchLastSection(true);
+    // 固定行高，行数很多时视图无需逐行计算高度
+    ui->borrowTableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
     connect(ui->borrowTableView->selectionModel(), &QItemSelectionModel::selectionChanged,
             this, &MainWindow::onBorrowSelectionChanged);
 }
@@ -141,6 +209,11 @@ void MainWindow::setupBorrowTab()
 void MainWindow::setupStatisticsTab()
 {
     // UI已经在.ui文件中定义，这里只需要刷新统计数据
+    connect(ui->verifyCountersAction, &QAction::triggered, this, &MainWindow::onVerifyCounters);
+    connect(ui->exportDataAction, &QAction::triggered, this, &MainWindow::onExportData);
+    connect(ui->backupDatabaseAction, &QAction::triggered, this, &MainWindow::onBackupDatabase);
+    connect(ui->restoreDatabaseAction, &QAction::triggered, this, &MainWindow::onRestoreDatabase);
+    connect(ui->diagnosticsAction, &QAction::triggered, this, &MainWindow::onShowDiagnostics);
     refreshStatistics();
 }
 
@@ -153,7 +226,7 @@ void MainWindow::showBookDialog(bool isEdit)
             QMessageBox::warning(this, "警告", "请先选择要编辑的图书！");
             return;
         }
-        currentBookId = bookModel->data(bookModel->index(indexes.first().row(), 0)).toInt();
+        currentBookId = bookModel->value(indexes.first().row(), "id").toInt();
     } else {
         currentBookId = -1;
     }
@@ -174,6 +247,11 @@ void MainWindow::showBookDialog(bool isEdit)
     QComboBox *categoryCombo = new QComboBox();
     categoryCombo->setEditable(true); // 允许手动输入其他分类
     categoryCombo->addItems(getDefaultCategories());
+    for (const QString& name : CategoryDictionary::getInstance().names()) {
+        if (categoryCombo->findText(name) < 0) {
+            categoryCombo->addItem(name);
+        }
+    }
     QSpinBox *totalCopiesEdit = new QSpinBox();
     totalCopiesEdit->setMinimum(1);
     totalCopiesEdit->setMaximum(9999);
@@ -191,22 +269,22 @@ void MainWindow::showBookDialog(bool isEdit)
     if (isEdit && currentBookId >= 0) {
         QModelIndexList indexes = ui->bookTableView->selectionModel()->selectedRows();
         QModelIndex index = indexes.first();
-        isbnEdit->setText(bookModel->data(bookModel->index(index.row(), 1)).toString());
-        titleEdit->setText(bookModel->data(bookModel->index(index.row(), 2)).toString());
-        authorEdit->setText(bookModel->data(bookModel->index(index.row(), 3)).toString());
-        publisherEdit->setText(bookModel->data(bookModel->index(index.row(), 4)).toString());
-        QString dateStr = bookModel->data(bookModel->index(index.row(), 5)).toString();
+        isbnEdit->setText(bookModel->value(index.row(), "isbn").toString());
+        titleEdit->setText(bookModel->value(index.row(), "title").toString());
+        authorEdit->setText(bookModel->value(index.row(), "author").toString());
+        publisherEdit->setText(bookModel->value(index.row(), "publisher").toString());
+        QString dateStr = bookModel->value(index.row(), "publish_date").toString();
         if (!dateStr.isEmpty()) {
             publishDateEdit->setDate(QDate::fromString(dateStr, "yyyy-MM-dd"));
         }
-        QString category = bookModel->data(bookModel->index(index.row(), 6)).toString();
+        QString category = bookModel->value(index.row(), "category").toString();
         int categoryIndex = categoryCombo->findText(category);
         if (categoryIndex >= 0) {
             categoryCombo->setCurrentIndex(categoryIndex);
         } else {
             categoryCombo->setCurrentText(category); // 如果不在列表中，设置为当前文本
         }
-        totalCopiesEdit->setValue(bookModel->data(bookModel->index(index.row(), 7)).toInt());
+        totalCopiesEdit->setValue(bookModel->value(index.row(), "total_copies").toInt());
     }
     
     QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
@@ -251,8 +329,7 @@ void MainWindow::showBookDialog(bool isEdit)
         if (success) {
             QMessageBox::information(this, "成功", isEdit ? "图书更新成功！" : "图书添加成功！");
             ui->statusbar->showMessage(isEdit ? "图书更新成功" : "图书添加成功", 3000);
-            // 刷新分类列表
-            loadBookCategories();
+            refreshStatistics();
         } else {
             // 检查是否是ISBN已存在的问题
             QString errorMsg;
@@ -280,7 +357,7 @@ void MainWindow::onDeleteBook()
         return;
     }
     
-    currentBookId = bookModel->data(bookModel->index(indexes.first().row(), 0)).toInt();
+    currentBookId = bookModel->value(indexes.first().row(), "id").toInt();
     
     int ret = QMessageBox::question(this, "确认", "确定要删除这本图书吗？",
                                     QMessageBox::Yes | QMessageBox::No);
@@ -288,30 +365,27 @@ void MainWindow::onDeleteBook()
         if (bookModel->deleteBook(currentBookId)) {
             QMessageBox::information(this, "成功", "图书删除成功！");
             ui->statusbar->showMessage("图书删除成功", 3000);
-            // 刷新分类列表
-            loadBookCategories();
+            refreshStatistics();
         } else {
             QMessageBox::warning(this, "失败", "图书删除失败！");
         }
     }
 }
 
-void MainWindow::onSearchBooks()
+void MainWindow::onSearchBooks(const QString& keyword)
 {
-    QString keyword = ui->bookSearchEdit->text();
     QString category = ui->bookCategoryCombo->currentData().toString();
     
     // 如果选择了分类，使用分类筛选
     if (!category.isEmpty()) {
-        bookModel->filterBooks("", "", "", category);
+        bookModel->filterByCategory(category);
     } else if (!keyword.isEmpty()) {
         // 如果有关键词，使用关键词搜索（不限制分类）
         bookModel->filterBooks(keyword, keyword, keyword, "");
     } else {
         // 清空筛选
-        bookModel->setFilter("");
+        bookModel->filterBooks();
     }
-    bookModel->select();
 }
 
 QStringList MainWindow::getDefaultCategories() const
@@ -322,13 +396,9 @@ QStringList MainWindow::getDefaultCategories() const
 
 void MainWindow::loadBookCategories()
 {
-    QSqlQuery query(DatabaseManager::getInstance().getDatabase());
-    query.exec("SELECT DISTINCT category FROM books WHERE category IS NOT NULL AND category != '' ORDER BY category");
-    
     // 保存当前选中的分类
     QString currentCategory = ui->bookCategoryCombo->currentData().toString();
     
-    // 清空并重新加载（保留"全部分类"选项）
     ui->bookCategoryCombo->clear();
     ui->bookCategoryCombo->addItem("全部分类", "");
     
@@ -338,12 +408,9 @@ void MainWindow::loadBookCategories()
         ui->bookCategoryCombo->addItem(cat, cat);
     }
     
-    // 添加数据库中已有的其他分类
-    QSet<QString> categories(defaultCategories.begin(), defaultCategories.end());
-    while (query.next()) {
-        QString cat = query.value(0).toString().trimmed();
-        if (!cat.isEmpty() && !categories.contains(cat)) {
-            categories.insert(cat);
+    // 添加分类字典中的其他分类（已按名称排序）
+    for (const QString &cat : CategoryDictionary::getInstance().names()) {
+        if (!defaultCategories.contains(cat)) {
             ui->bookCategoryCombo->addItem(cat, cat);
         }
     }
@@ -355,6 +422,34 @@ void MainWindow::loadBookCategories()
     }
 }
 
+void MainWindow::onCategoryAdded(const QString& category)
+{
+    if (ui->bookCategoryCombo->findData(category) >= 0) {
+        return;
+    }
+    
+    // 插入到预设分类之后、按名称排序的位置
+    int first = 1 + getDefaultCategories().size();
+    int row = first;
+    while (row < ui->bookCategoryCombo->count()
+           && ui->bookCategoryCombo->itemData(row).toString() < category) {
+        row++;
+    }
+    ui->bookCategoryCombo->insertItem(row, category, category);
+}
+
+void MainWindow::onCategoryRemoved(const QString& category)
+{
+    // 预设分类始终保留
+    if (getDefaultCategories().contains(category)) {
+        return;
+    }
+    int index = ui->bookCategoryCombo->findData(category);
+    if (index >= 0) {
+        ui->bookCategoryCombo->removeItem(index);
+    }
+}
+
 void MainWindow::onBookSelectionChanged()
 {
     QModelIndexList indexes = ui->bookTableView->selectionModel()->selectedRows();
@@ -363,7 +458,60 @@ void MainWindow::onBookSelectionChanged()
         return;
     }
     QModelIndex index = indexes.first();
-    currentBookId = bookModel->data(bookModel->index(index.row(), 0)).toInt();
+    currentBookId = bookModel->value(index.row(), "id").toInt();
+}
+
+// 批量导入图书
+void MainWindow::onImportBooks()
+{
+    if (bookImporter->isRunning()) {
+        QMessageBox::information(this, "提示", "已有导入任务正在进行！");
+        return;
+    }
+
+    QString filePath = QFileDialog::getOpenFileName(this, "选择图书目录文件", QString(),
+                                                    "图书目录 (*.csv *.mrk);;CSV文件 (*.csv);;MARC文本 (*.mrk)");
+    if (filePath.isEmpty()) {
+        return;
+    }
+
+    QProgressDialog *progress = new QProgressDialog("正在导入图书...", "取消", 0, 100, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(0);
+    progress->setAutoClose(false);
+    progress->setAutoReset(false);
+    progress->setValue(0);
+
+    connect(progress, &QProgressDialog::canceled, bookImporter, &BookImporter::cancel);
+    connect(bookImporter, &BookImporter::progressChanged, progress, &QProgressDialog::setValue);
+    connect(bookImporter, &BookImporter::finished, progress,
+            [this, progress](qint64 imported, qint64 skipped, bool cancelled, const QString& error) {
+                progress->deleteLater();
+
+                // 导入使用独立连接写入，内存索引需要重新加载
+                LookupCache::getInstance().loadAsync();
+
+                // 整个导入过程只刷新一次界面
+                bookModel->select();
+                CategoryDictionary::getInstance().load(DatabaseManager::getInstance().getDatabase());
+                refreshStatistics();
+
+                QString summary = QString("已导入 %1 本图书，跳过 %2 条无效记录").arg(imported).arg(skipped);
+                if (!error.isEmpty()) {
+                    QMessageBox::warning(this, "导入失败", summary + "\n" + error);
+                } else if (cancelled) {
+                    QMessageBox::information(this, "导入已取消", summary);
+                } else {
+                    ui->statusbar->showMessage(summary, 5000);
+                }
+            });
+
+    // 导入期间内存索引不再可靠，存在性检查回退到数据库
+    LookupCache::getInstance().clear();
+    if (!bookImporter->start(filePath)) {
+        progress->deleteLater();
+        LookupCache::getInstance().loadAsync();
+    }
 }
 
 // 显示读者对话框
@@ -375,7 +523,7 @@ void MainWindow::showReaderDialog(bool isEdit)
             QMessageBox::warning(this, "警告", "请先选择要编辑的读者！");
             return;
         }
-        currentReaderId = readerModel->data(readerModel->index(indexes.first().row(), 0)).toInt();
+        currentReaderId = readerModel->value(indexes.first().row(), "id").toInt();
     } else {
         currentReaderId = -1;
     }
@@ -405,14 +553,14 @@ void MainWindow::showReaderDialog(bool isEdit)
     if (isEdit && currentReaderId >= 0) {
         QModelIndexList indexes = ui->readerTableView->selectionModel()->selectedRows();
         QModelIndex index = indexes.first();
-        readerIdEdit->setText(readerModel->data(readerModel->index(index.row(), 1)).toString());
-        nameEdit->setText(readerModel->data(readerModel->index(index.row(), 2)).toString());
-        QString gender = readerModel->data(readerModel->index(index.row(), 3)).toString();
+        readerIdEdit->setText(readerModel->value(index.row(), "reader_id").toString());
+        nameEdit->setText(readerModel->value(index.row(), "name").toString());
+        QString gender = readerModel->value(index.row(), "gender").toString();
         int genderIndex = genderEdit->findText(gender);
         if (genderIndex >= 0) genderEdit->setCurrentIndex(genderIndex);
-        phoneEdit->setText(readerModel->data(readerModel->index(index.row(), 4)).toString());
-        emailEdit->setText(readerModel->data(readerModel->index(index.row(), 5)).toString());
-        addressEdit->setText(readerModel->data(readerModel->index(index.row(), 6)).toString());
+        phoneEdit->setText(readerModel->value(index.row(), "phone").toString());
+        emailEdit->setText(readerModel->value(index.row(), "email").toString());
+        addressEdit->setText(readerModel->value(index.row(), "address").toString());
     }
     
     QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
@@ -454,6 +602,7 @@ void MainWindow::showReaderDialog(bool isEdit)
         if (success) {
             QMessageBox::information(this, "成功", isEdit ? "读者更新成功！" : "读者添加成功！");
             ui->statusbar->showMessage(isEdit ? "读者更新成功" : "读者添加成功", 3000);
+            refreshStatistics();
         } else {
             QMessageBox::warning(this, "失败", isEdit ? "读者更新失败！" : "读者添加失败，读者编号可能已存在！");
         }
@@ -468,7 +617,7 @@ void MainWindow::onDeleteReader()
         return;
     }
     
-    currentReaderId = readerModel->data(readerModel->index(indexes.first().row(), 0)).toInt();
+    currentReaderId = readerModel->value(indexes.first().row(), "id").toInt();
     
     int ret = QMessageBox::question(this, "确认", "确定要删除这位读者吗？",
                                     QMessageBox::Yes | QMessageBox::No);
@@ -476,21 +625,21 @@ void MainWindow::onDeleteReader()
         if (readerModel->deleteReader(currentReaderId)) {
             QMessageBox::information(this, "成功", "读者删除成功！");
             ui->statusbar->showMessage("读者删除成功", 3000);
+            refreshStatistics();
         } else {
             QMessageBox::warning(this, "失败", "读者删除失败！");
         }
     }
 }
 
-void MainWindow::onSearchReaders()
+void MainWindow::onSearchReaders(const QString& keyword)
 {
-    QString keyword = ui->readerSearchEdit->text();
     if (keyword.isEmpty()) {
         readerModel->setFilter("");
+        readerModel->select();
     } else {
         readerModel->filterReaders(keyword, keyword, keyword, "");
     }
-    readerModel->select();
 }
 
 void MainWindow::onReaderSelectionChanged()
@@ -498,60 +647,161 @@ void MainWindow::onReaderSelectionChanged()
     QModelIndexList indexes = ui->readerTableView->selectionModel()->selectedRows();
     if (indexes.isEmpty()) {
         currentReaderId = -1;
+        readerLoansModel->setReader(QString());
+        ui->readerLoansSummaryLabel->setText("选择读者后显示当前借出和历史借阅记录");
         return;
     }
     QModelIndex index = indexes.first();
-    currentReaderId = readerModel->data(readerModel->index(index.row(), 0)).toInt();
+    currentReaderId = readerModel->value(index.row(), "id").toInt();
+    
+    QString readerId = readerModel->value(index.row(), "reader_id").toString();
+    ui->readerLoansSummaryLabel->setText(QString("读者 %1：正在读取...").arg(readerId));
+    readerLoansModel->setReader(readerId);
+}
+
+void MainWindow::onReaderLoansLoaded(const QString& readerId)
+{
+    int active = readerLoansModel->activeCount();
+    int overdue = readerLoansModel->overdueCount();
+    QString text = QString("读者 %1：当前借出 %2 本").arg(readerId).arg(active);
+    if (overdue > 0) {
+        text += QString("，其中逾期 %1 本").arg(overdue);
+    }
+    ui->readerLoansSummaryLabel->setText(text);
 }
 
-// 显示借书对话框
+// 借书：一个读者一次借多本，扫描（或输入后回车）的ISBN先加入列表，确认后在一个事务中全部登记
 void MainWindow::showBorrowDialog()
 {
     QDialog dialog(this);
     dialog.setWindowTitle("借书");
-    dialog.setMinimumWidth(350);
+    dialog.setMinimumWidth(420);
     
     QFormLayout *formLayout = new QFormLayout();
     
     QLineEdit *readerIdEdit = new QLineEdit();
     QLineEdit *bookIsbnEdit = new QLineEdit();
+    bookIsbnEdit->setPlaceholderText("扫描或输入ISBN后回车");
     QSpinBox *daysEdit = new QSpinBox();
     daysEdit->setMinimum(1);
     daysEdit->setMaximum(365);
     daysEdit->setValue(30);
+    QListWidget *isbnList = new QListWidget();
+    isbnList->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    QPushButton *removeBtn = new QPushButton("移除选中");
+    removeBtn->setAutoDefault(false);
+    QLabel *hintLabel = new QLabel();
     
     formLayout->addRow("读者编号*:", readerIdEdit);
     formLayout->addRow("图书ISBN*:", bookIsbnEdit);
     formLayout->addRow("借阅天数:", daysEdit);
+    formLayout->addRow("待借图书:", isbnList);
+    formLayout->addRow("", removeBtn);
+    formLayout->addRow(hintLabel);
     
     QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    buttonBox->button(QDialogButtonBox::Ok)->setText("全部借出");
+    // 扫码枪以回车结束输入：回车只把ISBN加入列表，不触发对话框的默认按钮。
+    // 按钮盒显示时会把第一个确认按钮设为默认按钮，要等显示之后再取消
+    for (QAbstractButton *button : buttonBox->buttons()) {
+        static_cast<QPushButton*>(button)->setAutoDefault(false);
+    }
+    QTimer::singleShot(0, &dialog, [buttonBox]() {
+        buttonBox->button(QDialogButtonBox::Ok)->setDefault(false);
+    });
     connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
     connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
     
+    // 按内存索引即时检查，不存在或副本已不够的图书不加入列表
+    QHash<QString, int> planned;
+    LookupCache& cache = LookupCache::getInstance();
+    connect(readerIdEdit, &QLineEdit::editingFinished, &dialog, [&]() {
+        QString readerId = readerIdEdit->text().trimmed();
+        if (!readerId.isEmpty() && cache.findReader(readerId) == LookupCache::Absent) {
+            hintLabel->setText(QString("读者不存在：%1").arg(readerId));
+        }
+    });
+    connect(bookIsbnEdit, &QLineEdit::returnPressed, &dialog, [&]() {
+        QString isbn = bookIsbnEdit->text().trimmed();
+        bookIsbnEdit->clear();
+        if (isbn.isEmpty()) {
+            return;
+        }
+        LookupCache::BookEntry entry;
+        LookupCache::Answer answer = cache.findBook(isbn, &entry);
+        if (answer == LookupCache::Absent) {
+            hintLabel->setText(QString("图书不存在：%1").arg(isbn));
+            return;
+        }
+        // 预约已到书的读者借出为其保留的那一册，不受可借册数限制
+        HoldQueue& holds = HoldQueue::getInstance();
+        int holdId = holds.activeHold(isbn, readerIdEdit->text().trimmed());
+        bool reserved = holdId > 0 && holds.hold(holdId).ready;
+        if (!reserved && answer == LookupCache::Found && planned.value(isbn) >= entry.availableCopies) {
+            hintLabel->setText(QString("图书已无可借副本：%1，可以为读者预约").arg(isbn));
+            return;
+        }
+        planned[isbn]++;
+        isbnList->addItem(isbn);
+        isbnList->scrollToBottom();
+        hintLabel->setText(QString("已加入 %1 本").arg(isbnList->count()));
+    });
+    connect(removeBtn, &QPushButton::clicked, &dialog, [&]() {
+        const QList<QListWidgetItem*> selected = isbnList->selectedItems();
+        for (QListWidgetItem *item : selected) {
+            if (--planned[item->text()] <= 0) {
+                planned.remove(item->text());
+            }
+            delete item;
+        }
+        hintLabel->setText(QString("已加入 %1 本").arg(isbnList->count()));
+    });
+    
     QVBoxLayout *mainLayout = new QVBoxLayout(&dialog);
     mainLayout->addLayout(formLayout);
     mainLayout->addWidget(buttonBox);
     
-    if (dialog.exec() == QDialog::Accepted) {
-        if (readerIdEdit->text().isEmpty() || bookIsbnEdit->text().isEmpty()) {
-            QMessageBox::warning(this, "警告", "读者编号和图书ISBN不能为空！");
-            return;
-        }
-        
-        bool success = borrowModel->borrowBook(
-            readerIdEdit->text(),
-            bookIsbnEdit->text(),
-            daysEdit->value()
-        );
-        
-        if (success) {
-            QMessageBox::information(this, "成功", "借书成功！");
-            refreshStatistics();
-            ui->statusbar->showMessage("借书成功", 3000);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    // 输入框中尚未回车的ISBN也一并借出
+    QStringList isbns;
+    for (int i = 0; i < isbnList->count(); i++) {
+        isbns << isbnList->item(i)->text();
+    }
+    if (!bookIsbnEdit->text().trimmed().isEmpty()) {
+        isbns << bookIsbnEdit->text().trimmed();
+    }
+    if (readerIdEdit->text().trimmed().isEmpty() || isbns.isEmpty()) {
+        QMessageBox::warning(this, "警告", "读者编号和图书ISBN不能为空！");
+        return;
+    }
+    
+    const QVector<BorrowModel::BatchItem> results =
+        borrowModel->borrowBooks(readerIdEdit->text().trimmed(), isbns, daysEdit->value());
+    
+    int borrowed = 0;
+    QStringList failures;
+    for (const BorrowModel::BatchItem& item : results) {
+        if (item.success) {
+            borrowed++;
         } else {
-            QMessageBox::warning(this, "失败", "借书失败，请检查读者编号、图书ISBN或图书是否可借！");
+            failures << QString("%1：%2").arg(item.bookIsbn, item.error);
         }
     }
+    
+    // 整批只刷新一次统计
+    if (borrowed > 0) {
+        refreshStatistics();
+        ui->statusbar->showMessage(QString("借书成功，共借出 %1 本").arg(borrowed), 3000);
+    }
+    if (failures.isEmpty()) {
+        QMessageBox::information(this, "成功", QString("借书成功！共借出 %1 本。").arg(borrowed));
+    } else {
+        QMessageBox::warning(this, borrowed > 0 ? "部分借书失败" : "失败",
+                             QString("借出 %1 本，以下图书未能借出：\n%2").arg(borrowed).arg(failures.join("\n")));
+    }
 }
 
 void MainWindow::onReturnBook()
@@ -562,10 +812,18 @@ void MainWindow::onReturnBook()
         return;
     }
     
-    currentBorrowId = borrowModel->data(borrowModel->index(indexes.first().row(), 0)).toInt();
+    // 可以同时选中多条记录一起归还
+    QList<int> recordIds;
+    double fine = 0.0;
+    for (const QModelIndex& index : std::as_const(indexes)) {
+        int recordId = borrowModel->value(index.row(), "id").toInt();
+        recordIds << recordId;
+        fine += borrowModel->calculateFine(recordId);
+    }
+    currentBorrowId = recordIds.first();
     
-    double fine = borrowModel->calculateFine(currentBorrowId);
-    QString message = "确定要归还这本书吗？";
+    QString message = recordIds.size() == 1 ? QString("确定要归还这本书吗？")
+                                            : QString("确定要归还选中的 %1 本书吗？").arg(recordIds.size());
     if (fine > 0) {
         message += QString("\n逾期罚款：%1 元").arg(fine, 0, 'f', 2);
     }
@@ -573,26 +831,199 @@ void MainWindow::onReturnBook()
     int ret = QMessageBox::question(this, "确认", message,
                                     QMessageBox::Yes | QMessageBox::No);
     if (ret == QMessageBox::Yes) {
-        if (borrowModel->returnBook(currentBorrowId)) {
-            QMessageBox::information(this, "成功", fine > 0 ? 
-                QString("还书成功！逾期罚款：%1 元").arg(fine, 0, 'f', 2) : "还书成功！");
-            refreshStatistics();
-            ui->statusbar->showMessage("还书成功", 3000);
+        returnLoans(recordIds);
+    }
+}
+
+// 扫码还书：扫描的ISBN逐本对应到借出中的记录，确认后在一个事务中全部归还
+void MainWindow::onScanReturn()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("扫码还书");
+    dialog.setMinimumWidth(420);
+    
+    QFormLayout *formLayout = new QFormLayout();
+    
+    QLineEdit *readerIdEdit = new QLineEdit();
+    readerIdEdit->setPlaceholderText("可选，同一本书被多位读者借出时用于区分");
+    QLineEdit *bookIsbnEdit = new QLineEdit();
+    bookIsbnEdit->setPlaceholderText("扫描或输入ISBN后回车");
+    QListWidget *loanList = new QListWidget();
+    QLabel *hintLabel = new QLabel();
+    
+    formLayout->addRow("读者编号:", readerIdEdit);
+    formLayout->addRow("图书ISBN*:", bookIsbnEdit);
+    formLayout->addRow("待还图书:", loanList);
+    formLayout->addRow(hintLabel);
+    
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    buttonBox->button(QDialogButtonBox::Ok)->setText("全部归还");
+    // 与借书对话框相同：回车只加入列表，显示后取消按钮盒设置的默认按钮
+    for (QAbstractButton *button : buttonBox->buttons()) {
+        static_cast<QPushButton*>(button)->setAutoDefault(false);
+    }
+    QTimer::singleShot(0, &dialog, [buttonBox]() {
+        buttonBox->button(QDialogButtonBox::Ok)->setDefault(false);
+    });
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    
+    // 同一ISBN扫描多次时依次对应到应还日期最早、尚未加入列表的记录
+    QList<int> recordIds;
+    connect(bookIsbnEdit, &QLineEdit::returnPressed, &dialog, [&]() {
+        QString isbn = bookIsbnEdit->text().trimmed();
+        bookIsbnEdit->clear();
+        if (isbn.isEmpty()) {
+            return;
+        }
+        const QList<int> openLoans = borrowModel->findOpenLoans(isbn, readerIdEdit->text().trimmed());
+        for (int recordId : openLoans) {
+            if (!recordIds.contains(recordId)) {
+                recordIds << recordId;
+                loanList->addItem(QString("%1（借阅记录 %2）").arg(isbn).arg(recordId));
+                loanList->scrollToBottom();
+                hintLabel->setText(QString("已加入 %1 本").arg(recordIds.size()));
+                return;
+            }
+        }
+        hintLabel->setText(QString("没有借出中的记录：%1").arg(isbn));
+    });
+    
+    QVBoxLayout *mainLayout = new QVBoxLayout(&dialog);
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(buttonBox);
+    
+    if (dialog.exec() != QDialog::Accepted || recordIds.isEmpty()) {
+        return;
+    }
+    returnLoans(recordIds);
+}
+
+// 预约：图书全部借出时为读者排队，或取消读者的预约
+void MainWindow::showHoldDialog()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("图书预约");
+    dialog.setMinimumWidth(360);
+    
+    QFormLayout *formLayout = new QFormLayout();
+    QLineEdit *readerIdEdit = new QLineEdit();
+    QLineEdit *bookIsbnEdit = new QLineEdit();
+    QLabel *queueLabel = new QLabel();
+    formLayout->addRow("读者编号*:", readerIdEdit);
+    formLayout->addRow("图书ISBN*:", bookIsbnEdit);
+    formLayout->addRow(queueLabel);
+    
+    // 排队人数和该读者的预约状态直接取自内存中的预约队列
+    HoldQueue& holds = HoldQueue::getInstance();
+    auto updateQueue = [&]() {
+        QString isbn = bookIsbnEdit->text().trimmed();
+        if (isbn.isEmpty()) {
+            queueLabel->clear();
+            return;
+        }
+        QString text = QString("等待中的预约：%1 人").arg(holds.waitingCount(isbn));
+        int holdId = holds.activeHold(isbn, readerIdEdit->text().trimmed());
+        if (holdId > 0) {
+            text += holds.hold(holdId).ready ? "；该读者的预约已到书" : "；该读者已在排队";
+        }
+        queueLabel->setText(text);
+    };
+    connect(readerIdEdit, &QLineEdit::textChanged, &dialog, updateQueue);
+    connect(bookIsbnEdit, &QLineEdit::textChanged, &dialog, updateQueue);
+    
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
+    QPushButton *placeBtn = buttonBox->addButton("预约", QDialogButtonBox::ActionRole);
+    QPushButton *cancelHoldBtn = buttonBox->addButton("取消预约", QDialogButtonBox::ActionRole);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    
+    connect(placeBtn, &QPushButton::clicked, &dialog, [&]() {
+        QString readerId = readerIdEdit->text().trimmed();
+        QString isbn = bookIsbnEdit->text().trimmed();
+        if (readerId.isEmpty() || isbn.isEmpty()) {
+            QMessageBox::warning(&dialog, "警告", "读者编号和图书ISBN不能为空！");
+            return;
+        }
+        QString error;
+        if (borrowModel->placeHold(readerId, isbn, &error) == 0) {
+            QMessageBox::warning(&dialog, "预约失败", error);
+            return;
+        }
+        updateQueue();
+        ui->statusbar->showMessage(QString("预约成功，排在第 %1 位").arg(holds.waitingCount(isbn)), 5000);
+    });
+    connect(cancelHoldBtn, &QPushButton::clicked, &dialog, [&]() {
+        int holdId = holds.activeHold(bookIsbnEdit->text().trimmed(), readerIdEdit->text().trimmed());
+        if (holdId == 0) {
+            QMessageBox::warning(&dialog, "警告", "该读者没有预约此书！");
+            return;
+        }
+        QString error;
+        if (!borrowModel->cancelHold(holdId, &error)) {
+            QMessageBox::warning(&dialog, "取消失败", error);
+            return;
+        }
+        updateQueue();
+        refreshStatistics();
+        ui->statusbar->showMessage("预约已取消", 3000);
+    });
+    
+    QVBoxLayout *mainLayout = new QVBoxLayout(&dialog);
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(buttonBox);
+    dialog.exec();
+}
+
+void MainWindow::returnLoans(const QList<int>& recordIds)
+{
+    const QVector<BorrowModel::BatchItem> results = borrowModel->returnBooks(recordIds);
+    
+    int returned = 0;
+    double fine = 0.0;
+    QStringList failures;
+    QStringList reserved;
+    for (const BorrowModel::BatchItem& item : results) {
+        if (item.success) {
+            returned++;
+            fine += item.fine;
+            if (item.holdId > 0) {
+                reserved << QString("%1 → 读者 %2").arg(item.bookIsbn, item.holdReaderId);
+            }
         } else {
-            QMessageBox::warning(this, "失败", "还书失败！");
+            failures << QString("借阅记录 %1：%2").arg(item.recordId).arg(item.error);
         }
     }
+    
+    // 整批只刷新一次统计
+    if (returned > 0) {
+        refreshStatistics();
+        ui->statusbar->showMessage(QString("还书成功，共归还 %1 本").arg(returned), 3000);
+    }
+    QString summary = returned == 1 ? QString("还书成功！") : QString("还书成功！共归还 %1 本。").arg(returned);
+    if (fine > 0) {
+        summary += QString("逾期罚款：%1 元").arg(fine, 0, 'f', 2);
+    }
+    // 归还的副本已分配给预约的读者，需放到预约架而不是上架
+    if (!reserved.isEmpty()) {
+        summary += "\n以下图书已有预约，请留给预约读者：\n" + reserved.join("\n");
+    }
+    if (failures.isEmpty()) {
+        QMessageBox::information(this, "成功", summary);
+    } else if (returned == 0) {
+        QMessageBox::warning(this, "失败", "还书失败！\n" + failures.join("\n"));
+    } else {
+        QMessageBox::warning(this, "部分还书失败", summary + "\n以下记录未能归还：\n" + failures.join("\n"));
+    }
 }
 
-void MainWindow::onSearchBorrowRecords()
+void MainWindow::onSearchBorrowRecords(const QString& keyword)
 {
-    QString keyword = ui->borrowSearchEdit->text();
     if (keyword.isEmpty()) {
         borrowModel->setFilter("");
+        borrowModel->select();
     } else {
         borrowModel->filterRecords(keyword, keyword, "");
     }
-    borrowModel->select();
 }
 
 void MainWindow::onBorrowSelectionChanged()
@@ -603,43 +1034,341 @@ void MainWindow::onBorrowSelectionChanged()
         return;
     }
     QModelIndex index = indexes.first();
-    currentBorrowId = borrowModel->data(borrowModel->index(index.row(), 0)).toInt();
+    currentBorrowId = borrowModel->value(index.row(), "id").toInt();
+}
+
+// 已归档的记录只在勾选时查询，平时借阅列表只读取borrow_records
+void MainWindow::onShowArchiveToggled(bool checked)
+{
+    borrowModel->setArchiveView(checked);
+    currentBorrowId = -1;
+    // 归档的记录都已归还，不能再还书
+    ui->returnBookBtn->setEnabled(!checked);
+    ui->statusbar->showMessage(checked ? "正在查看已归档的借阅记录" : "就绪", 3000);
+}
+
+// 归档借阅记录：把归还满指定天数的记录移到归档表
+void MainWindow::onArchiveLoans()
+{
+    if (loanArchiver->isRunning()) {
+        QMessageBox::information(this, "提示", "已有归档任务正在进行！");
+        return;
+    }
+
+    QDialog dialog(this);
+    dialog.setWindowTitle("归档借阅记录");
+
+    QFormLayout *formLayout = new QFormLayout();
+    QSpinBox *daysSpin = new QSpinBox();
+    daysSpin->setRange(0, 3650);
+    daysSpin->setValue(LoanArchiver::DefaultHorizonDays);
+    daysSpin->setSuffix(" 天");
+    formLayout->addRow("归还超过:", daysSpin);
+    QLabel *hintLabel = new QLabel("归档后的记录不再出现在借阅列表、逾期查询中，\n"
+                                   "勾选\"查看已归档记录\"或在读者借阅历史中仍可查阅；统计总数不变。");
+    hintLabel->setStyleSheet("color: gray;");
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(&dialog);
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(hintLabel);
+    mainLayout->addWidget(buttonBox);
+
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    // 总数事先未知，只显示已归档的条数
+    QProgressDialog *progress = new QProgressDialog("正在归档借阅记录...", "取消", 0, 0, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(500);
+    progress->setAutoClose(false);
+    progress->setAutoReset(false);
+
+    connect(progress, &QProgressDialog::canceled, loanArchiver, &LoanArchiver::cancel);
+    connect(loanArchiver, &LoanArchiver::progressChanged, progress, [progress](qint64 archived) {
+        progress->setLabelText(QString("正在归档借阅记录...已归档 %1 条").arg(archived));
+    });
+    connect(loanArchiver, &LoanArchiver::finished, progress,
+            [this, progress](qint64 archived, bool cancelled, const QString& error) {
+                progress->deleteLater();
+
+                // 归档使用独立连接写入，整个过程只刷新一次列表
+                if (archived > 0) {
+                    borrowModel->select();
+                    refreshStatistics();
+                }
+
+                QString summary = QString("已归档 %1 条借阅记录").arg(archived);
+                if (!error.isEmpty()) {
+                    QMessageBox::warning(this, "归档失败", summary + "\n" + error);
+                } else if (cancelled) {
+                    QMessageBox::information(this, "归档已取消", summary);
+                } else {
+                    ui->statusbar->showMessage(summary, 5000);
+                }
+            });
+
+    if (!loanArchiver->start(daysSpin->value())) {
+        progress->deleteLater();
+    }
 }
 
 // 统计信息
 void MainWindow::refreshStatistics()
 {
-    // 图书总数
-    QSqlQuery query(DatabaseManager::getInstance().getDatabase());
-    query.exec("SELECT COUNT(*) FROM books");
-    if (query.next()) {
-        ui->totalBooksLabel->setText(QString::number(query.value(0).toInt()));
-    }
+    // 计数由触发器在借还书、增删图书和读者时同步维护，这里只读取计数表
+    QHash<QString, qint64> counters = DatabaseManager::getInstance().readCounters();
+    ui->totalBooksLabel->setText(QString::number(counters.value("books")));
+    ui->totalReadersLabel->setText(QString::number(counters.value("readers")));
+    ui->currentBorrowsLabel->setText(QString::number(counters.value("current_borrows")));
     
-    // 读者总数
-    query.exec("SELECT COUNT(*) FROM readers");
-    if (query.next()) {
-        ui->totalReadersLabel->setText(QString::number(query.value(0).toInt()));
+    // 逾期数由逾期调度器维护，加载完成前暂不显示
+    if (overdueScheduler->isLoaded()) {
+        ui->overdueCountLabel->setText(QString::number(overdueScheduler->overdueCount()));
+    }
+}
+
+// 校验统计计数
+void MainWindow::onVerifyCounters()
+{
+    QStringList mismatches = DatabaseManager::getInstance().verifyCounters(false);
+    if (mismatches.isEmpty()) {
+        QMessageBox::information(this, "校验统计计数", "统计计数与数据一致。");
+        return;
     }
     
-    // 借阅统计
-    BorrowModel::Statistics stats = borrowModel->getStatistics();
-    ui->currentBorrowsLabel->setText(QString::number(stats.currentBorrows));
-    ui->overdueCountLabel->setText(QString::number(stats.overdueCount));
+    int ret = QMessageBox::question(this, "校验统计计数",
+                                    "以下统计计数与数据不一致：\n" + mismatches.join("\n") + "\n\n是否按重新统计的结果修复？",
+                                    QMessageBox::Yes | QMessageBox::No);
+    if (ret == QMessageBox::Yes) {
+        DatabaseManager::getInstance().verifyCounters(true);
+        refreshStatistics();
+        ui->statusbar->showMessage("统计计数已修复", 3000);
+    }
+}
+
+// 导出数据
+void MainWindow::onExportData()
+{
+    if (dataExporter->isRunning()) {
+        QMessageBox::information(this, "提示", "已有导出任务正在进行！");
+        return;
+    }
+
+    QDialog dialog(this);
+    dialog.setWindowTitle("导出数据");
+
+    QFormLayout *formLayout = new QFormLayout();
+    QComboBox *tableCombo = new QComboBox();
+    tableCombo->addItem("图书", "books");
+    tableCombo->addItem("读者", "readers");
+    tableCombo->addItem("借阅记录", "borrow_records");
+    QComboBox *formatCombo = new QComboBox();
+    formatCombo->addItem("CSV", static_cast<int>(DataExporter::Csv));
+    formatCombo->addItem("NDJSON（每行一个JSON对象）", static_cast<int>(DataExporter::Ndjson));
+    formatCombo->addItem("列式二进制", static_cast<int>(DataExporter::Columnar));
+    formLayout->addRow("数据:", tableCombo);
+    formLayout->addRow("格式:", formatCombo);
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(&dialog);
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(buttonBox);
+
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    QString table = tableCombo->currentData().toString();
+    DataExporter::Format format = static_cast<DataExporter::Format>(formatCombo->currentData().toInt());
+    QString suffix = DataExporter::fileSuffix(format);
+    QString filePath = QFileDialog::getSaveFileName(this, "导出到", table + "." + suffix,
+                                                    QString("%1 (*.%2)").arg(formatCombo->currentText(), suffix));
+    if (filePath.isEmpty()) {
+        return;
+    }
+
+    QProgressDialog *progress = new QProgressDialog("正在导出...", "取消", 0, 100, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(0);
+    progress->setAutoClose(false);
+    progress->setAutoReset(false);
+    progress->setValue(0);
+
+    connect(progress, &QProgressDialog::canceled, dataExporter, &DataExporter::cancel);
+    connect(dataExporter, &DataExporter::progressChanged, progress, &QProgressDialog::setValue);
+    connect(dataExporter, &DataExporter::finished, progress,
+            [this, progress](qint64 rows, bool cancelled, const QString& error) {
+                progress->deleteLater();
+
+                if (!error.isEmpty()) {
+                    QMessageBox::warning(this, "导出失败", error);
+                } else if (cancelled) {
+                    ui->statusbar->showMessage("导出已取消", 5000);
+                } else {
+                    ui->statusbar->showMessage(QString("已导出 %1 行").arg(rows), 5000);
+                }
+            });
+
+    if (!dataExporter->start(table, format, filePath)) {
+        progress->deleteLater();
+    }
+}
+
+// 备份数据库：后台生成快照，期间可以继续借还书
+void MainWindow::onBackupDatabase()
+{
+    if (!databaseBackup->start()) {
+        QMessageBox::information(this, "提示", "已有备份任务正在进行！");
+        return;
+    }
+    ui->statusbar->showMessage("正在备份数据库...");
+}
+
+void MainWindow::onBackupFinished(const QString& path, const QString& error)
+{
+    // 定时快照失败只在状态栏提示，不打断操作
+    if (!error.isEmpty()) {
+        ui->statusbar->showMessage(QString("备份失败：%1").arg(error), 10000);
+        return;
+    }
+    ui->statusbar->showMessage(QString("已备份到 %1").arg(QDir::toNativeSeparators(path)), 5000);
+}
+
+// 从备份恢复：校验快照后关闭窗口，由main()在所有连接关闭后替换数据库文件并重新打开
+void MainWindow::onRestoreDatabase()
+{
+    if (bookImporter->isRunning() || dataExporter->isRunning() || databaseBackup->isRunning()
+        || loanArchiver->isRunning()) {
+        QMessageBox::information(this, "提示", "请等待导入、导出、备份或归档任务完成后再恢复！");
+        return;
+    }
+
+    DatabaseManager& manager = DatabaseManager::getInstance();
+    QString directory = DatabaseBackup::snapshotDirectory(databaseBackup->schedule(), manager.databasePath());
+    QString snapshotPath = QFileDialog::getOpenFileName(this, "选择快照", directory, "数据库快照 (*.db)");
+    if (snapshotPath.isEmpty()) {
+        return;
+    }
+
+    int version = 0;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QString problem = DatabaseBackup::verifySnapshot(snapshotPath, false, &version);
+    QApplication::restoreOverrideCursor();
+    if (!problem.isEmpty()) {
+        QMessageBox::warning(this, "无法恢复", QString("快照校验失败：%1").arg(problem));
+        return;
+    }
+
+    QString question = QString("快照 %1 校验通过（结构版本 %2）。\n\n"
+                               "快照之后的所有修改都将丢失，当前数据库文件保留为 .before-restore。\n"
+                               "窗口将关闭并在恢复后重新打开，确定恢复吗？")
+                           .arg(QFileInfo(snapshotPath).fileName()).arg(version);
+    if (QMessageBox::question(this, "确认恢复", question) != QMessageBox::Yes) {
+        return;
+    }
+
+    DatabaseBackup::setPendingRestore(snapshotPath);
+    close();
+}
+
+// 诊断信息：语句缓存、内存索引、读连接和查询性能分析
+void MainWindow::onShowDiagnostics()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("诊断信息");
+    dialog.resize(900, 600);
+
+    QPlainTextEdit *reportEdit = new QPlainTextEdit();
+    reportEdit->setReadOnly(true);
+    reportEdit->setLineWrapMode(QPlainTextEdit::NoWrap);
+    reportEdit->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    QueryProfiler& profiler = QueryProfiler::getInstance();
+    QCheckBox *enabledCheck = new QCheckBox("开启查询性能分析");
+    enabledCheck->setChecked(profiler.isEnabled());
+    QSpinBox *thresholdEdit = new QSpinBox();
+    thresholdEdit->setRange(0, 60000);
+    thresholdEdit->setSuffix(" 毫秒");
+    thresholdEdit->setValue(profiler.slowThreshold());
+    QPushButton *refreshBtn = new QPushButton("刷新");
+    QPushButton *resetBtn = new QPushButton("清空统计");
+
+    auto refreshReport = [reportEdit]() {
+        DatabaseManager& manager = DatabaseManager::getInstance();
+        DatabaseManager::StatementCacheStats statements = manager.statementCacheStats();
+        LookupCache::Stats lookup = LookupCache::getInstance().stats();
+
+        QStringList lines;
+        lines << QString("语句缓存: 命中 %1 次，未命中 %2 次，已缓存 %3 条")
+                     .arg(statements.hits).arg(statements.misses).arg(statements.cachedStatements);
+        lines << QString("内存索引: %1，图书 %2，读者 %3；命中 %4 次，确定不存在 %5 次，回退查询 %6 次")
+                     .arg(lookup.loaded ? "已加载" : "未加载")
+                     .arg(lookup.books).arg(lookup.readers)
+                     .arg(lookup.hits).arg(lookup.negatives).arg(lookup.fallbacks);
+        lines << QString("读连接: 已打开 %1 个，后台查询线程 %2 个")
+                     .arg(manager.readConnectionCount())
+                     .arg(DatabaseWorker::getInstance().threadCount());
+        lines << QString();
+        lines << QueryProfiler::getInstance().report(20, manager.getDatabase());
+        reportEdit->setPlainText(lines.join('\n'));
+    };
+
+    connect(enabledCheck, &QCheckBox::toggled, &dialog, [&profiler](bool checked) {
+        profiler.setEnabled(checked);
+    });
+    connect(thresholdEdit, QOverload<int>::of(&QSpinBox::valueChanged), &dialog, [&profiler](int ms) {
+        profiler.setSlowThreshold(ms);
+    });
+    connect(refreshBtn, &QPushButton::clicked, &dialog, refreshReport);
+    connect(resetBtn, &QPushButton::clicked, &dialog, [&profiler, refreshReport]() {
+        profiler.reset();
+        refreshReport();
+    });
+
+    QHBoxLayout *controlLayout = new QHBoxLayout();
+    controlLayout->addWidget(enabledCheck);
+    controlLayout->addWidget(new QLabel("慢查询阈值:"));
+    controlLayout->addWidget(thresholdEdit);
+    controlLayout->addStretch();
+    controlLayout->addWidget(refreshBtn);
+    controlLayout->addWidget(resetBtn);
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(&dialog);
+    mainLayout->addLayout(controlLayout);
+    mainLayout->addWidget(reportEdit);
+    mainLayout->addWidget(buttonBox);
+
+    refreshReport();
+    dialog.exec();
 }
 
 // 逾期提醒
 void MainWindow::checkOverdueBooks()
 {
-    QList<int> overdueIds = borrowModel->getOverdueRecords();
-    if (!overdueIds.isEmpty()) {
-        QString message = QString("发现 %1 本图书逾期未归还！").arg(overdueIds.size());
+    int overdueCount = overdueScheduler->overdueCount();
+    if (overdueCount > 0) {
+        QString message = QString("发现 %1 本图书逾期未归还！").arg(overdueCount);
         ui->statusbar->showMessage(message, 10000);
         
-        // 刷新借阅记录视图以显示逾期高亮
-        borrowModel->select();
-        
         // 可选：显示消息框提醒
         // QMessageBox::warning(this, "逾期提醒", message);
     }
 }
+
+void MainWindow::onRecordsOverdue(const QList<int>& recordIds)
+{
+    QString message = QString("新增 %1 本图书逾期未归还！").arg(recordIds.size());
+    ui->statusbar->showMessage(message, 10000);
+    ui->overdueCountLabel->setText(QString::number(overdueScheduler->overdueCount()));
+}
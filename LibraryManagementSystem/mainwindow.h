@@ -21,9 +21,20 @@
 #include <QStatusBar>
 
 #include "databasemanager.h"
+#include "databaseworker.h"
 #include "bookmodel.h"
 #include "readermodel.h"
+#include "readerloansmodel.h"
 #include "borrowmodel.h"
+#include "overduescheduler.h"
+#include "bookimporter.h"
+#include "dataexporter.h"
+#include "databasebackup.h"
+#include "loanarchiver.h"
+#include "lookupcache.h"
+#include "categorydictionary.h"
+#include "holdqueue.h"
+#include "searchcontroller.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -36,30 +47,44 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    explicit MainWindow(const QString& dbPath, QWidget *parent = nullptr);
     ~MainWindow();
 
 private slots:
     // 图书管理
     void onDeleteBook();
-    void onSearchBooks();
+    void onSearchBooks(const QString& keyword);
     void onBookSelectionChanged();
+    void onImportBooks();
+    void onCategoryAdded(const QString& category);
+    void onCategoryRemoved(const QString& category);
     
     // 读者管理
     void onDeleteReader();
-    void onSearchReaders();
+    void onSearchReaders(const QString& keyword);
     void onReaderSelectionChanged();
+    void onReaderLoansLoaded(const QString& readerId);
     
     // 借还书管理
     void onReturnBook();
-    void onSearchBorrowRecords();
+    void onScanReturn();
+    void onSearchBorrowRecords(const QString& keyword);
     void onBorrowSelectionChanged();
+    void onShowArchiveToggled(bool checked);
+    void onArchiveLoans();
     
     // 统计信息
     void refreshStatistics();
+    void onVerifyCounters();
+    void onExportData();
+    void onBackupDatabase();
+    void onRestoreDatabase();
+    void onBackupFinished(const QString& path, const QString& error);
+    void onShowDiagnostics();
     
     // 逾期提醒
     void checkOverdueBooks();
+    void onRecordsOverdue(const QList<int>& recordIds);
 
 private:
     Ui::MainWindow *ui;
@@ -67,10 +92,26 @@ private:
     // 数据库和模型
     BookModel *bookModel;
     ReaderModel *readerModel;
+    ReaderLoansModel *readerLoansModel;
     BorrowModel *borrowModel;
     
-    // 定时器（用于逾期提醒）
-    QTimer *overdueTimer;
+    // 逾期调度器（按应还日期触发逾期提醒）
+    OverdueScheduler *overdueScheduler;
+    
+    // 图书批量导入（后台线程）
+    BookImporter *bookImporter;
+    DataExporter *dataExporter;
+    
+    // 数据库快照（后台线程，按配置定时执行）
+    DatabaseBackup *databaseBackup;
+    
+    // 借阅记录归档（后台线程，分批移动已归还的旧记录）
+    LoanArchiver *loanArchiver;
+    
+    // 各标签页的检索控制（合并按键、作废过期查询）
+    SearchController *bookSearch;
+    SearchController *readerSearch;
+    SearchController *borrowSearch;
     
     // 当前选中的ID
     int currentBookId;
@@ -85,6 +126,8 @@ private:
     void showBookDialog(bool isEdit = false);
     void showReaderDialog(bool isEdit = false);
     void showBorrowDialog();
+    void showHoldDialog();
+    void returnLoans(const QList<int>& recordIds);
     void loadBookCategories();
     QStringList getDefaultCategories() const;
 };
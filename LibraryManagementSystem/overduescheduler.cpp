@@ -0,0 +1,153 @@
+#include "overduescheduler.h"
+#include "databaseworker.h"
+#include "queryprofiler.h"
+#include <QDateTime>
+#include <functional>
+#include <utility>
+
+// 没有临近的应还日期时也定期检查一次，以应对系统时间调整或休眠
+static const qint64 MaxCheckIntervalMs = 3600000;
+
+OverdueScheduler::OverdueScheduler(QObject *parent)
+    : QObject(parent)
+{
+    timer.setSingleShot(true);
+    connect(&timer, &QTimer::timeout, this, &OverdueScheduler::checkDue);
+}
+
+void OverdueScheduler::load()
+{
+    // 儒略日在SQL中计算（julianday以正午为界，加0.5取整后与QDate::toJulianDay一致），
+    // 避免逐条解析日期字符串
+    DatabaseWorker::getInstance().submit(
+        "SELECT id, CAST(julianday(due_date) + 0.5 AS INTEGER) FROM borrow_records "
+        "WHERE status='借出' AND due_date IS NOT NULL",
+        QVariantList(), this, [this](const QueryResult& result) {
+            if (!result.success) {
+                qCWarning(lcModel) << "加载未归还记录失败:" << result.error;
+                return;
+            }
+
+            qint64 today = QDate::currentDate().toJulianDay();
+            std::vector<Entry> entries;
+            entries.reserve(result.rows.size());
+            for (const QVariantList& row : result.rows) {
+                if (row.value(1).isNull()) {
+                    continue;
+                }
+                int recordId = row.value(0).toInt();
+                qint64 dueDay = row.value(1).toLongLong();
+                // 借书、还书可能在加载完成前已经登记，以增量更新为准
+                if (pendingLoans.contains(recordId) || overdueLoans.contains(recordId)
+                    || removedBeforeLoad.contains(recordId)) {
+                    continue;
+                }
+                if (dueDay < today) {
+                    overdueLoans.insert(recordId);
+                } else {
+                    pendingLoans.insert(recordId, dueDay);
+                    entries.push_back(Entry{dueDay, recordId});
+                }
+            }
+
+            // 初始数据一次性建堆（O(n)），加载前登记的借书逐条并入
+            decltype(heap) seeded(std::greater<Entry>(), std::move(entries));
+            while (!heap.empty()) {
+                seeded.push(heap.top());
+                heap.pop();
+            }
+            heap.swap(seeded);
+            removedBeforeLoad.clear();
+
+            ready = true;
+            emit loaded();
+            scheduleNext();
+        });
+}
+
+bool OverdueScheduler::isLoaded() const
+{
+    return ready;
+}
+
+void OverdueScheduler::addLoan(int recordId, const QDate& dueDate)
+{
+    if (!dueDate.isValid()) {
+        return;
+    }
+
+    qint64 dueDay = dueDate.toJulianDay();
+    if (dueDay < QDate::currentDate().toJulianDay()) {
+        overdueLoans.insert(recordId);
+        emit recordsOverdue(QList<int>() << recordId);
+        return;
+    }
+
+    pendingLoans.insert(recordId, dueDay);
+    heap.push(Entry{dueDay, recordId});
+    if (ready && heap.top().recordId == recordId) {
+        scheduleNext();
+    }
+}
+
+void OverdueScheduler::removeLoan(int recordId)
+{
+    // 加载结果可能读取于还书之前，记下已归还的记录，加载时跳过
+    if (!ready) {
+        removedBeforeLoad.insert(recordId);
+    }
+    pendingLoans.remove(recordId);
+    overdueLoans.remove(recordId);
+}
+
+int OverdueScheduler::overdueCount() const
+{
+    return overdueLoans.size();
+}
+
+void OverdueScheduler::checkDue()
+{
+    qint64 today = QDate::currentDate().toJulianDay();
+    QList<int> newlyOverdue;
+
+    while (!heap.empty() && heap.top().dueDay < today) {
+        Entry entry = heap.top();
+        heap.pop();
+
+        // 已归还或应还日期已变更的旧条目直接丢弃
+        auto it = pendingLoans.find(entry.recordId);
+        if (it == pendingLoans.end() || it.value() != entry.dueDay) {
+            continue;
+        }
+        pendingLoans.erase(it);
+        overdueLoans.insert(entry.recordId);
+        newlyOverdue.append(entry.recordId);
+    }
+
+    if (!newlyOverdue.isEmpty()) {
+        emit recordsOverdue(newlyOverdue);
+    }
+    scheduleNext();
+}
+
+void OverdueScheduler::scheduleNext()
+{
+    // 丢弃堆顶已失效的条目，保证定时器按真实的下一个应还日期设置
+    while (!heap.empty()) {
+        auto it = pendingLoans.constFind(heap.top().recordId);
+        if (it != pendingLoans.constEnd() && it.value() == heap.top().dueDay) {
+            break;
+        }
+        heap.pop();
+    }
+
+    if (heap.empty()) {
+        timer.start(static_cast<int>(MaxCheckIntervalMs));
+        return;
+    }
+
+    // 应还日期次日零点起记为逾期
+    QDateTime overdueAt(QDate::fromJulianDay(heap.top().dueDay + 1), QTime(0, 0));
+    qint64 delay = QDateTime::currentDateTime().msecsTo(overdueAt);
+    timer.start(static_cast<int>(qBound<qint64>(0, delay, MaxCheckIntervalMs)));
+}
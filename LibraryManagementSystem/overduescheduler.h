@@ -0,0 +1,63 @@
+#ifndef OVERDUESCHEDULER_H
+#define OVERDUESCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QDate>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <queue>
+#include <vector>
+
+// 逾期调度器：按应还日期维护未归还记录的最小堆，只在最近的应还日期过去时触发，
+// 并且只报告新增的逾期记录
+class OverdueScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OverdueScheduler(QObject *parent = nullptr);
+
+    // 在后台线程读取全部未归还记录作为初始数据（启动时调用一次）
+    void load();
+    bool isLoaded() const;
+
+    // 借书/还书时增量更新
+    void addLoan(int recordId, const QDate& dueDate);
+    void removeLoan(int recordId);
+
+    // 当前逾期未归还的记录数
+    int overdueCount() const;
+
+signals:
+    // 初始数据加载完成
+    void loaded();
+
+    // 新增的逾期记录
+    void recordsOverdue(const QList<int>& recordIds);
+
+private slots:
+    void checkDue();
+
+private:
+    struct Entry {
+        qint64 dueDay;  // 应还日期的儒略日
+        int recordId;
+        bool operator>(const Entry& other) const {
+            return dueDay != other.dueDay ? dueDay > other.dueDay : recordId > other.recordId;
+        }
+    };
+
+    void scheduleNext();
+
+    // 已归还的记录不立即从堆中删除，出堆时与pendingLoans比对后丢弃
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    QHash<int, qint64> pendingLoans;  // 未归还且尚未逾期：记录ID -> 应还日期
+    QSet<int> overdueLoans;           // 已逾期且未归还
+    QSet<int> removedBeforeLoad;      // 加载完成前归还的记录
+    QTimer timer;
+    bool ready = false;
+};
+
+#endif // OVERDUESCHEDULER_H
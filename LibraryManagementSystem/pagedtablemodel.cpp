@@ -0,0 +1,470 @@
+#include "pagedtablemodel.h"
+#include "databaseworker.h"
+#include "databasemanager.h"
+#include "queryprofiler.h"
+#include <QSqlRecord>
+#include <QSet>
+#include <utility>
+
+bool PagedTableModel::headless = false;
+
+PagedTableModel::PagedTableModel(QObject *parent, QSqlDatabase db)
+    : QAbstractTableModel(parent)
+    , db(db)
+{
+}
+
+void PagedTableModel::setTable(const QString& tableName)
+{
+    beginResetModel();
+    table = tableName;
+    fields.clear();
+    headers.clear();
+
+    // 列信息来自启动时读取的表结构，无需读取任何数据行；未加载时（其他数据库）查询连接
+    TableSchema schema = DatabaseManager::getInstance().schema().table(tableName);
+    if (schema.isValid()) {
+        fields = schema.columns;
+    } else {
+        QSqlRecord record = db.record(tableName);
+        for (int i = 0; i < record.count(); i++) {
+            fields << record.fieldName(i);
+        }
+    }
+    keyColumn = qMax(0, fields.indexOf("id"));
+
+    for (auto it = pages.constBegin(); it != pages.constEnd(); ++it) {
+        pageEvicted(it.key());
+    }
+    pages.clear();
+    pendingPages.clear();
+    failedPages.clear();
+    pageLowerBounds.clear();
+    totalRows = 0;
+    endResetModel();
+}
+
+QString PagedTableModel::tableName() const
+{
+    return table;
+}
+
+QSqlDatabase PagedTableModel::database() const
+{
+    return db;
+}
+
+int PagedTableModel::fieldIndex(const QString& fieldName) const
+{
+    return fields.indexOf(fieldName);
+}
+
+QVariant PagedTableModel::value(int row, const QString& fieldName) const
+{
+    int column = fields.indexOf(fieldName);
+    return column >= 0 ? data(index(row, column)) : QVariant();
+}
+
+void PagedTableModel::setFilter(const QString& filter)
+{
+    filterClause = filter;
+}
+
+QString PagedTableModel::filter() const
+{
+    return filterClause;
+}
+
+void PagedTableModel::setPageSize(int rows)
+{
+    pageRows = qMax(1, rows);
+}
+
+int PagedTableModel::pageSize() const
+{
+    return pageRows;
+}
+
+void PagedTableModel::setCachedPageLimit(int pages)
+{
+    maxCachedPages = qMax(3, pages);
+}
+
+bool PagedTableModel::select()
+{
+    if (table.isEmpty()) {
+        return false;
+    }
+
+    // 新一代查询：之前未完成的请求全部作废
+    generation++;
+    DatabaseWorker& worker = DatabaseWorker::getInstance();
+    for (int ticket : std::as_const(pendingPages)) {
+        worker.cancel(ticket);
+    }
+    pendingPages.clear();
+    failedPages.clear();
+    pageLowerBounds.clear();
+    worker.cancel(countTicket);
+    countTicket = 0;
+
+    // 主键限定只作用于本次查询
+    restrictionClause.clear();
+    if (restrictNext) {
+        restrictNext = false;
+        if (pendingRestriction.isEmpty()) {
+            // 结果已知为空，无需查询
+            resetRowCount(0);
+            return true;
+        }
+        QStringList keys;
+        keys.reserve(pendingRestriction.size());
+        for (int key : std::as_const(pendingRestriction)) {
+            keys << QString::number(key);
+        }
+        restrictionClause = QString("%1.%2 IN (%3)").arg(table, fields.value(keyColumn), keys.join(','));
+        pendingRestriction.clear();
+    }
+    if (headless) {
+        resetRowCount(0);
+        return true;
+    }
+
+    int currentGeneration = generation;
+    QString sql = QString("SELECT COUNT(*) FROM %1%2").arg(fromClause(), whereClause());
+    countTicket = worker.submit(sql, QVariantList(), this,
+                                [this, currentGeneration](const QueryResult& result) {
+                                    onCountReady(currentGeneration, result);
+                                });
+    return countTicket > 0;
+}
+
+void PagedTableModel::setHeadless(bool enabled)
+{
+    headless = enabled;
+}
+
+int PagedTableModel::selectGeneration() const
+{
+    return generation;
+}
+
+bool PagedTableModel::cachedKeys(QList<int>* keys) const
+{
+    if (countTicket != 0 || fields.isEmpty()) {
+        return false;
+    }
+
+    QList<int> result;
+    result.reserve(totalRows);
+    for (int firstRow = 0; firstRow < totalRows; firstRow += pageRows) {
+        auto it = pages.constFind(firstRow / pageRows);
+        if (it == pages.constEnd() || it->generation != generation
+            || it->rows.size() < qMin(pageRows, totalRows - firstRow)) {
+            return false;
+        }
+        for (const QVariantList& row : it->rows) {
+            result << row.value(keyColumn).toInt();
+        }
+    }
+
+    *keys = result;
+    return true;
+}
+
+void PagedTableModel::restrictNextSelect(const QList<int>& keys)
+{
+    pendingRestriction = keys;
+    restrictNext = true;
+}
+
+int PagedTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : totalRows;
+}
+
+int PagedTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : fields.size();
+}
+
+QVariant PagedTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= totalRows)
+        return QVariant();
+
+    if (role != Qt::DisplayRole && role != Qt::EditRole)
+        return QVariant();
+
+    const QVariantList* row = cachedRow(index.row());
+    if (!row) {
+        return QVariant();
+    }
+    return row->value(index.column());
+}
+
+QVariant PagedTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+        auto it = headers.constFind(section);
+        if (it != headers.constEnd()) {
+            return it.value();
+        }
+        return fields.value(section);
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+bool PagedTableModel::setHeaderData(int section, Qt::Orientation orientation, const QVariant &value, int role)
+{
+    if (orientation != Qt::Horizontal || section < 0 || section >= fields.size()
+        || (role != Qt::EditRole && role != Qt::DisplayRole)) {
+        return false;
+    }
+
+    headers.insert(section, value);
+    emit headerDataChanged(orientation, section, section);
+    return true;
+}
+
+Qt::ItemFlags PagedTableModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+}
+
+void PagedTableModel::refreshKeys(const QList<int>& keys)
+{
+    if (keys.isEmpty() || fields.isEmpty()) {
+        return;
+    }
+
+    QSet<qint64> keySet;
+    for (int key : keys) {
+        keySet.insert(key);
+    }
+
+    for (auto it = pages.constBegin(); it != pages.constEnd(); ++it) {
+        int firstRow = it.key() * pageRows;
+        for (int i = 0; i < it->rows.size(); i++) {
+            if (firstRow + i < totalRows && keySet.contains(it->rows.at(i).value(keyColumn).toLongLong())) {
+                emit dataChanged(index(firstRow + i, 0), index(firstRow + i, fields.size() - 1));
+            }
+        }
+    }
+}
+
+QString PagedTableModel::fromClause() const
+{
+    return table;
+}
+
+QString PagedTableModel::orderClause() const
+{
+    return QString();
+}
+
+void PagedTableModel::pageLoaded(int page, const QVector<QVariantList>& rows)
+{
+    Q_UNUSED(page);
+    Q_UNUSED(rows);
+}
+
+void PagedTableModel::pageEvicted(int page)
+{
+    Q_UNUSED(page);
+}
+
+const QVariantList* PagedTableModel::cachedRow(int row) const
+{
+    int page = row / pageRows;
+    int offset = row % pageRows;
+    lastRequestedPage = page;
+
+    auto it = pages.find(page);
+    if (it == pages.end()) {
+        fetchPage(page);
+        return nullptr;
+    }
+
+    it->lastUsed = ++useCounter;
+
+    // 接近页边界时预取相邻页，滚动时不出现空白
+    if (offset >= pageRows * 3 / 4 && (page + 1) * pageRows < totalRows && !pages.contains(page + 1)) {
+        fetchPage(page + 1);
+    } else if (offset < pageRows / 4 && page > 0 && !pages.contains(page - 1)) {
+        fetchPage(page - 1);
+    }
+
+    if (offset >= it->rows.size()) {
+        return nullptr;
+    }
+    return &it->rows.at(offset);
+}
+
+QString PagedTableModel::columnList() const
+{
+    QStringList columns;
+    for (const QString& field : fields) {
+        columns << table + "." + field;
+    }
+    return columns.join(", ");
+}
+
+QString PagedTableModel::whereClause(const QString& extraCondition) const
+{
+    QStringList conditions;
+    if (!filterClause.isEmpty()) {
+        conditions << "(" + filterClause + ")";
+    }
+    if (!restrictionClause.isEmpty()) {
+        conditions << restrictionClause;
+    }
+    if (!extraCondition.isEmpty()) {
+        conditions << extraCondition;
+    }
+    if (conditions.isEmpty()) {
+        return QString();
+    }
+    return " WHERE " + conditions.join(" AND ");
+}
+
+void PagedTableModel::fetchPage(int page) const
+{
+    if (pendingPages.contains(page) || failedPages.contains(page)) {
+        return;
+    }
+
+    QString key = table + "." + fields.value(keyColumn);
+    QString order = orderClause();
+    QString sql;
+    QVariantList values;
+
+    if (order.isEmpty() && (page == 0 || pageLowerBounds.contains(page))) {
+        // 键集分页：从上一页最后的主键继续，代价与页号无关
+        QString condition;
+        if (page > 0) {
+            condition = key + " > ?";
+            values << pageLowerBounds.value(page);
+        }
+        sql = QString("SELECT %1 FROM %2%3 ORDER BY %4 LIMIT ?")
+                  .arg(columnList(), fromClause(), whereClause(condition), key);
+        values << pageRows;
+    } else {
+        // 直接跳转到未访问过的位置时没有可用的键，退化为OFFSET
+        sql = QString("SELECT %1 FROM %2%3 ORDER BY %4 LIMIT ? OFFSET ?")
+                  .arg(columnList(), fromClause(), whereClause(),
+                       order.isEmpty() ? key : order + ", " + key);
+        values << pageRows << page * pageRows;
+    }
+
+    PagedTableModel* self = const_cast<PagedTableModel*>(this);
+    int currentGeneration = generation;
+    int ticket = DatabaseWorker::getInstance().submit(sql, values, self,
+        [self, currentGeneration, page](const QueryResult& result) {
+            self->onPageReady(currentGeneration, page, result);
+        });
+    if (ticket > 0) {
+        pendingPages.insert(page, ticket);
+    }
+}
+
+void PagedTableModel::onCountReady(int requestGeneration, const QueryResult& result)
+{
+    if (requestGeneration != generation) {
+        return;
+    }
+    countTicket = 0;
+
+    if (!result.success || result.rows.isEmpty()) {
+        qCWarning(lcModel) << "统计行数失败:" << table << result.error;
+        return;
+    }
+
+    resetRowCount(result.rows.first().value(0).toInt());
+}
+
+void PagedTableModel::resetRowCount(int rows)
+{
+    beginResetModel();
+    // 丢弃旧查询条件下缓存的页，新条件下已读取的页保留
+    for (auto it = pages.begin(); it != pages.end();) {
+        if (it->generation != generation) {
+            pageEvicted(it.key());
+            it = pages.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    totalRows = rows;
+    endResetModel();
+
+    emit selectFinished();
+}
+
+void PagedTableModel::onPageReady(int requestGeneration, int page, const QueryResult& result)
+{
+    if (requestGeneration != generation) {
+        return;
+    }
+    pendingPages.remove(page);
+
+    if (!result.success) {
+        // 本次查询内不再重试，否则每次重绘都会重新提交同一个失败的查询；下一次select()时再读取
+        qCWarning(lcModel) << "读取数据页失败:" << table << page << result.error;
+        failedPages.insert(page);
+        return;
+    }
+
+    if (pages.contains(page)) {
+        pageEvicted(page);
+    }
+
+    Page entry;
+    entry.generation = generation;
+    entry.lastUsed = ++useCounter;
+    entry.rows = result.rows;
+    pages.insert(page, entry);
+
+    // 记录相邻页的起始键，之后读取这些页时可以使用键集分页
+    if (orderClause().isEmpty() && !entry.rows.isEmpty()) {
+        if (page > 0 && !pageLowerBounds.contains(page)) {
+            pageLowerBounds.insert(page, entry.rows.first().value(keyColumn).toLongLong() - 1);
+        }
+        if (entry.rows.size() == pageRows) {
+            pageLowerBounds.insert(page + 1, entry.rows.last().value(keyColumn).toLongLong());
+        }
+    }
+
+    pageLoaded(page, entry.rows);
+    evictDistantPages(lastRequestedPage);
+
+    int firstRow = page * pageRows;
+    int lastRow = qMin(firstRow + entry.rows.size(), totalRows) - 1;
+    if (lastRow >= firstRow && !fields.isEmpty()) {
+        emit dataChanged(index(firstRow, 0), index(lastRow, fields.size() - 1));
+    }
+}
+
+void PagedTableModel::evictDistantPages(int centerPage)
+{
+    // 超出缓存上限时，淘汰离当前位置最远的页
+    while (pages.size() > maxCachedPages) {
+        int farthest = -1;
+        int farthestDistance = -1;
+        for (auto it = pages.constBegin(); it != pages.constEnd(); ++it) {
+            int distance = qAbs(it.key() - centerPage);
+            if (distance > farthestDistance) {
+                farthest = it.key();
+                farthestDistance = distance;
+            }
+        }
+        if (farthest < 0) {
+            break;
+        }
+        pageEvicted(farthest);
+        pages.remove(farthest);
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef PAGEDTABLEMODEL_H
+#define PAGEDTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QVariant>
+
+struct QueryResult;
+
+// 分页表格模型：只读取可见区域及预取范围内的行，远离可见区域的页会被淘汰。
+// 数据通过DatabaseWorker在后台线程读取，按主键做键集分页（id > 上一页最后的id）。
+class PagedTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit PagedTableModel(QObject *parent = nullptr, QSqlDatabase db = QSqlDatabase());
+
+    void setTable(const QString& tableName);
+    QString tableName() const;
+    QSqlDatabase database() const;
+    int fieldIndex(const QString& fieldName) const;
+
+    // 按字段名取已缓存行的值（未缓存时发起读取并返回空值）
+    QVariant value(int row, const QString& fieldName) const;
+
+    void setFilter(const QString& filter);
+    QString filter() const;
+
+    // 每页行数与最多缓存的页数
+    void setPageSize(int rows);
+    int pageSize() const;
+    void setCachedPageLimit(int pages);
+
+    // 重新统计行数并清空缓存，可见区域的数据按需重新读取
+    virtual bool select();
+
+    // 无界面模式（命令行）没有视图：select()不再统计行数，模型保持为空，只用于借还书等写操作
+    static void setHeadless(bool headless);
+
+    // 查询代数：每次select()加一，用于判断模型内容是否仍来自同一次查询
+    int selectGeneration() const;
+
+    // 取当前结果的全部主键；只有行数已统计且所有行都已缓存时返回true
+    bool cachedKeys(QList<int>* keys) const;
+
+    // 把下一次select()的结果限定在给定主键内，之后的select()不再受限；
+    // 主键为空时直接得到空结果，不访问数据库
+    void restrictNextSelect(const QList<int>& keys);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool setHeaderData(int section, Qt::Orientation orientation, const QVariant &value,
+                       int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    // 通知视图重绘指定主键所在的行（只处理已缓存的行）
+    void refreshKeys(const QList<int>& keys);
+
+signals:
+    // 行数统计完成、模型已重置
+    void selectFinished();
+
+protected:
+    // 查询的FROM子句，默认为表名
+    virtual QString fromClause() const;
+
+    // 自定义排序，为空时按主键排序并使用键集分页；否则退化为OFFSET分页
+    virtual QString orderClause() const;
+
+    // 页加载/淘汰通知，子类可以为每页维护附加数据
+    virtual void pageLoaded(int page, const QVector<QVariantList>& rows);
+    virtual void pageEvicted(int page);
+
+    // 获取已缓存的行，不在缓存中时发起读取并返回nullptr
+    const QVariantList* cachedRow(int row) const;
+
+private:
+    struct Page {
+        int generation = 0;
+        quint64 lastUsed = 0;
+        QVector<QVariantList> rows;
+    };
+
+    QString columnList() const;
+    QString whereClause(const QString& extraCondition = QString()) const;
+    void fetchPage(int page) const;
+    void onCountReady(int requestGeneration, const QueryResult& result);
+    void resetRowCount(int rows);
+    void onPageReady(int requestGeneration, int page, const QueryResult& result);
+    void evictDistantPages(int centerPage);
+
+    QSqlDatabase db;
+    QString table;
+    QString filterClause;
+    QString restrictionClause;
+    QList<int> pendingRestriction;
+    bool restrictNext = false;
+    QStringList fields;
+    QHash<int, QVariant> headers;
+    int keyColumn = 0;
+    int totalRows = 0;
+    int pageRows = 200;
+    int maxCachedPages = 10;
+    int generation = 0;
+    int countTicket = 0;
+
+    mutable QHash<int, Page> pages;
+    mutable QHash<int, int> pendingPages;        // 页号 -> 请求编号
+    QSet<int> failedPages;                       // 本次查询中读取失败的页
+    mutable QHash<int, qint64> pageLowerBounds;  // 页号 -> 该页之前的最大主键
+    mutable quint64 useCounter = 0;
+    mutable int lastRequestedPage = 0;
+
+    static bool headless;
+};
+
+#endif // PAGEDTABLEMODEL_H
@@ -0,0 +1,206 @@
+#include "queryprofiler.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QStringList>
+#include <QtAlgorithms>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(lcSql, "library.sql", QtWarningMsg)
+Q_LOGGING_CATEGORY(lcModel, "library.model", QtWarningMsg)
+
+namespace {
+
+int bucketFor(qint64 elapsedNs)
+{
+    quint64 micros = static_cast<quint64>(qMax<qint64>(1, elapsedNs / 1000));
+    int bucket = 63 - qCountLeadingZeroBits(micros);
+    return qMin(bucket, QueryProfiler::BucketCount - 1);
+}
+
+QString formatMillis(qint64 ns)
+{
+    return QString::number(ns / 1000000.0, 'f', 3);
+}
+
+} // namespace
+
+qint64 QueryProfiler::Entry::percentileMicros(double fraction) const
+{
+    if (calls == 0) {
+        return 0;
+    }
+    quint64 rank = qMax<quint64>(1, static_cast<quint64>(fraction * calls + 0.999999));
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount; i++) {
+        seen += histogram[i];
+        if (seen >= rank) {
+            return qint64(1) << (i + 1);
+        }
+    }
+    return maxNs / 1000;
+}
+
+QueryProfiler& QueryProfiler::getInstance()
+{
+    static QueryProfiler instance;
+    return instance;
+}
+
+QueryProfiler::QueryProfiler()
+{
+    if (qEnvironmentVariableIntValue("LIBRARY_PROFILE") != 0) {
+        enabled.storeRelaxed(1);
+    }
+    bool ok = false;
+    int slowMs = qEnvironmentVariableIntValue("LIBRARY_SLOW_QUERY_MS", &ok);
+    if (ok) {
+        setSlowThreshold(slowMs);
+    }
+}
+
+void QueryProfiler::setEnabled(bool on)
+{
+    enabled.storeRelaxed(on ? 1 : 0);
+}
+
+int QueryProfiler::slowThreshold() const
+{
+    return static_cast<int>(slowThresholdNs.loadRelaxed() / 1000000);
+}
+
+void QueryProfiler::setSlowThreshold(int ms)
+{
+    slowThresholdNs.storeRelaxed(qMax(0, ms) * qint64(1000000));
+}
+
+void QueryProfiler::record(const QSqlQuery& query, qint64 elapsedNs, qint64 rows, bool success)
+{
+    const QString sql = query.lastQuery();
+    const bool slow = elapsedNs >= slowThresholdNs.loadRelaxed();
+
+    {
+        QMutexLocker locker(&mutex);
+        Entry& entry = statements[sql];
+        if (entry.calls == 0) {
+            entry.sql = sql;
+        }
+        entry.calls++;
+        entry.totalNs += elapsedNs;
+        entry.histogram[bucketFor(elapsedNs)]++;
+        if (rows > 0) {
+            entry.rows += rows;
+        }
+        if (!success) {
+            entry.errors++;
+        }
+        if (slow) {
+            entry.slowCalls++;
+        }
+        if (elapsedNs > entry.maxNs) {
+            entry.maxNs = elapsedNs;
+            // 只为最慢的一次保存参数，查询计划在生成报告时才计算
+            if (slow) {
+                entry.slowestValues.clear();
+                const int count = query.boundValues().size();
+                for (int i = 0; i < count; i++) {
+                    entry.slowestValues << query.boundValue(i);
+                }
+            }
+        }
+    }
+
+    if (slow) {
+        qCInfo(lcSql).noquote() << "慢查询" << formatMillis(elapsedNs) << "毫秒:" << sql;
+    }
+}
+
+QList<QueryProfiler::Entry> QueryProfiler::entries() const
+{
+    QList<Entry> result;
+    {
+        QMutexLocker locker(&mutex);
+        result = statements.values();
+    }
+    std::sort(result.begin(), result.end(), [](const Entry& a, const Entry& b) {
+        return a.totalNs > b.totalNs;
+    });
+    return result;
+}
+
+void QueryProfiler::reset()
+{
+    QMutexLocker locker(&mutex);
+    statements.clear();
+}
+
+QString QueryProfiler::report(int limit, const QSqlDatabase& db) const
+{
+    const QList<Entry> all = entries();
+    quint64 totalCalls = 0;
+    qint64 totalNs = 0;
+    for (const Entry& entry : all) {
+        totalCalls += entry.calls;
+        totalNs += entry.totalNs;
+    }
+
+    QStringList lines;
+    lines << QString("性能分析%1，慢查询阈值 %2 毫秒")
+                 .arg(isEnabled() ? "已开启" : "未开启")
+                 .arg(slowThreshold());
+    lines << QString("语句 %1 条，执行 %2 次，总耗时 %3 毫秒")
+                 .arg(all.size())
+                 .arg(totalCalls)
+                 .arg(formatMillis(totalNs));
+
+    for (int i = 0; i < all.size() && i < limit; i++) {
+        const Entry& entry = all.at(i);
+        lines << QString();
+        lines << QString("#%1 总耗时 %2 毫秒，调用 %3 次，平均 %4 毫秒，p50≤%5 微秒，p99≤%6 微秒，最长 %7 毫秒")
+                     .arg(i + 1)
+                     .arg(formatMillis(entry.totalNs))
+                     .arg(entry.calls)
+                     .arg(formatMillis(entry.totalNs / qMax<qint64>(1, entry.calls)))
+                     .arg(entry.percentileMicros(0.5))
+                     .arg(entry.percentileMicros(0.99))
+                     .arg(formatMillis(entry.maxNs));
+        lines << QString("   行数 %1，慢查询 %2 次，失败 %3 次")
+                     .arg(entry.rows)
+                     .arg(entry.slowCalls)
+                     .arg(entry.errors);
+        lines << "   " + entry.sql.simplified();
+        if (entry.slowCalls > 0 && db.isOpen()) {
+            lines << "   查询计划:";
+            lines << queryPlan(entry.sql, entry.slowestValues, db);
+        }
+    }
+    return lines.join('\n');
+}
+
+QString QueryProfiler::queryPlan(const QString& sql, const QVariantList& values, const QSqlDatabase& db)
+{
+    QString trimmed = sql.trimmed();
+    if (trimmed.startsWith("BEGIN", Qt::CaseInsensitive) || trimmed.startsWith("PRAGMA", Qt::CaseInsensitive)) {
+        return "     （无）";
+    }
+
+    QSqlQuery query(db);
+    if (!query.prepare("EXPLAIN QUERY PLAN " + trimmed)) {
+        return "     " + query.lastError().text();
+    }
+    for (const QVariant& value : values) {
+        query.addBindValue(value);
+    }
+    if (!query.exec()) {
+        return "     " + query.lastError().text();
+    }
+
+    // 各行依次为 id, parent, notused, detail；按父节点缩进
+    QHash<int, int> depths;
+    QStringList plan;
+    while (query.next()) {
+        int depth = depths.value(query.value(1).toInt(), 0) + 1;
+        depths.insert(query.value(0).toInt(), depth);
+        plan << QString(3 + depth * 2, ' ') + query.value(3).toString();
+    }
+    return plan.join('\n');
+}
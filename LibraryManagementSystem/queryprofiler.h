@@ -0,0 +1,78 @@
+#ifndef QUERYPROFILER_H
+#define QUERYPROFILER_H
+
+#include <QString>
+#include <QVariant>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInteger>
+#include <QSqlDatabase>
+#include <QLoggingCategory>
+#include <array>
+
+class QSqlQuery;
+
+// 日志分类，默认只输出警告；运行时用QT_LOGGING_RULES开启，例如
+//   QT_LOGGING_RULES="library.model.debug=true;library.sql.info=true"
+// 定义QT_NO_DEBUG_OUTPUT编译时，qCDebug整体被移除
+Q_DECLARE_LOGGING_CATEGORY(lcSql)
+Q_DECLARE_LOGGING_CATEGORY(lcModel)
+
+// 查询性能分析：按SQL文本统计调用次数、耗时分布、返回/影响行数和慢查询。
+// 默认关闭，关闭时每次执行只多一次原子读；环境变量LIBRARY_PROFILE=1时启动即开启，
+// LIBRARY_SLOW_QUERY_MS设置慢查询阈值（毫秒，默认50）
+class QueryProfiler
+{
+public:
+    // 耗时分布：第i个桶为 [2^i, 2^(i+1)) 微秒，最后一个桶包含更长的耗时
+    static const int BucketCount = 24;
+
+    struct Entry {
+        QString sql;
+        quint64 calls = 0;
+        quint64 errors = 0;
+        quint64 slowCalls = 0;
+        qint64 totalNs = 0;
+        qint64 maxNs = 0;
+        qint64 rows = 0;                 // 返回的行数（后台查询）或影响的行数（增删改）
+        std::array<quint64, BucketCount> histogram{};
+        QVariantList slowestValues;      // 最慢一次超过阈值的调用所绑定的参数，用于生成查询计划
+
+        // 按耗时分布估算的分位数（桶的上界，微秒）
+        qint64 percentileMicros(double fraction) const;
+    };
+
+    static QueryProfiler& getInstance();
+
+    bool isEnabled() const { return enabled.loadRelaxed() != 0; }
+    void setEnabled(bool on);
+
+    int slowThreshold() const;
+    void setSlowThreshold(int ms);
+
+    // 记录一次执行；rows为负数时表示行数未知
+    void record(const QSqlQuery& query, qint64 elapsedNs, qint64 rows, bool success);
+
+    // 按总耗时从高到低排序
+    QList<Entry> entries() const;
+    void reset();
+
+    // 文本报告：前limit条语句，慢查询附带EXPLAIN QUERY PLAN（在db上执行）
+    QString report(int limit, const QSqlDatabase& db) const;
+
+private:
+    QueryProfiler();
+    QueryProfiler(const QueryProfiler&) = delete;
+    QueryProfiler& operator=(const QueryProfiler&) = delete;
+
+    static QString queryPlan(const QString& sql, const QVariantList& values, const QSqlDatabase& db);
+
+    QAtomicInteger<int> enabled = 0;
+    QAtomicInteger<qint64> slowThresholdNs = 50 * 1000 * 1000;
+
+    mutable QMutex mutex;
+    QHash<QString, Entry> statements;
+};
+
+#endif // QUERYPROFILER_H
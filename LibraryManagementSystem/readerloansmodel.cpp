@@ -0,0 +1,338 @@
+#include "readerloansmodel.h"
+#include "databaseworker.h"
+#include "queryprofiler.h"
+#include <QDate>
+#include <QColor>
+
+namespace {
+
+// 借出中的记录按应还日期排列；(reader_id, status)索引定位，books.isbn唯一索引取书名
+const char* ActiveLoansSql =
+    "SELECT r.id, r.book_isbn, b.title, r.borrow_date, r.due_date, r.return_date, r.status, r.fine_amount "
+    "FROM borrow_records r LEFT JOIN books b ON b.isbn = r.book_isbn "
+    "WHERE r.reader_id = ? AND r.status = '借出' "
+    "ORDER BY r.due_date, r.id";
+
+// 历史记录按借阅ID倒序做键集分页，每页只读取索引中紧接着的若干条；
+// 已归档的记录同样属于历史，两张表都按(reader_id, id)索引定位后按ID合并
+const char* HistorySql =
+    "SELECT r.id, r.book_isbn, b.title, r.borrow_date, r.due_date, r.return_date, r.status, r.fine_amount "
+    "FROM (SELECT id, book_isbn, borrow_date, due_date, return_date, status, fine_amount FROM borrow_records "
+    "      WHERE reader_id = ? AND status = '已归还' AND id < ? "
+    "      UNION ALL "
+    "      SELECT id, book_isbn, borrow_date, due_date, return_date, status, fine_amount FROM borrow_records_archive "
+    "      WHERE reader_id = ? AND id < ?) r "
+    "LEFT JOIN books b ON b.isbn = r.book_isbn "
+    "ORDER BY r.id DESC LIMIT ?";
+
+} // namespace
+
+ReaderLoansModel::ReaderLoansModel(QObject *parent)
+    : QAbstractTableModel(parent)
+    , today(QDate::currentDate().toJulianDay())
+{
+}
+
+void ReaderLoansModel::setReader(const QString& readerId)
+{
+    beginResetModel();
+    current = readerId;
+    today = QDate::currentDate().toJulianDay();
+    endResetModel();
+
+    if (current.isEmpty()) {
+        return;
+    }
+
+    auto it = cache.find(current);
+    if (it == cache.end()) {
+        loadActive(current);
+        return;
+    }
+    it->lastUsed = ++useCounter;
+    if (it->activeLoaded) {
+        emit loaded(current);
+    }
+}
+
+QString ReaderLoansModel::reader() const
+{
+    return current;
+}
+
+void ReaderLoansModel::invalidate(const QString& readerId)
+{
+    if (!cache.contains(readerId)) {
+        return;
+    }
+    // 尚未返回的请求随缓存一起作废（回调中按请求编号核对）
+    cache.remove(readerId);
+    if (readerId == current) {
+        setReader(readerId);
+    }
+}
+
+void ReaderLoansModel::clearCache()
+{
+    cache.clear();
+    if (!current.isEmpty()) {
+        setReader(current);
+    }
+}
+
+int ReaderLoansModel::activeCount() const
+{
+    auto it = cache.constFind(current);
+    return it != cache.constEnd() ? it->active.size() : 0;
+}
+
+int ReaderLoansModel::overdueCount() const
+{
+    auto it = cache.constFind(current);
+    if (it == cache.constEnd()) {
+        return 0;
+    }
+    int count = 0;
+    for (const Loan& loan : it->active) {
+        if (loan.dueDay < today) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int ReaderLoansModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    auto it = cache.constFind(current);
+    if (it == cache.constEnd()) {
+        return 0;
+    }
+    return it->active.size() + it->history.size();
+}
+
+int ReaderLoansModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant ReaderLoansModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+    const Loan* loan = loanAt(index.row());
+    if (!loan) {
+        return QVariant();
+    }
+
+    if (role == Qt::TextAlignmentRole) {
+        return Qt::AlignCenter;
+    }
+
+    // 逾期未还的记录高亮显示
+    if (role == Qt::BackgroundRole && index.column() == StatusColumn) {
+        if (loan->dueDay < today) {
+            static const QColor overdueColor = QColor(Qt::red).lighter(180);
+            return overdueColor;
+        }
+        return QVariant();
+    }
+
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    switch (index.column()) {
+    case IdColumn:         return loan->id;
+    case TitleColumn:      return loan->title;
+    case IsbnColumn:       return loan->isbn;
+    case BorrowDateColumn: return loan->borrowDate;
+    case DueDateColumn:    return loan->dueDate;
+    case ReturnDateColumn: return loan->returnDate;
+    case StatusColumn:     return loan->status;
+    case FineColumn:       return loan->fine;
+    default:               return QVariant();
+    }
+}
+
+QVariant ReaderLoansModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    switch (section) {
+    case IdColumn:         return "ID";
+    case TitleColumn:      return "书名";
+    case IsbnColumn:       return "图书ISBN";
+    case BorrowDateColumn: return "借阅日期";
+    case DueDateColumn:    return "应还日期";
+    case ReturnDateColumn: return "归还日期";
+    case StatusColumn:     return "状态";
+    case FineColumn:       return "罚款金额";
+    default:               return QVariant();
+    }
+}
+
+bool ReaderLoansModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return false;
+    }
+    auto it = cache.constFind(current);
+    // 当前借出的记录先显示，之后才读取历史记录；同一时间只有一个历史请求
+    return it != cache.constEnd() && it->activeLoaded && !it->historyComplete && it->historyTicket == 0;
+}
+
+void ReaderLoansModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent)) {
+        return;
+    }
+
+    ReaderLoans& loans = cache[current];
+    QString readerId = current;
+    QVariantList values;
+    values << readerId << loans.historyBound << readerId << loans.historyBound << HistoryPageSize;
+    loans.historyTicket = DatabaseWorker::getInstance().submit(QString::fromUtf8(HistorySql), values, this,
+        [this, readerId](const QueryResult& result) {
+            onHistoryReady(readerId, result);
+        });
+    if (loans.historyTicket == 0) {
+        // 后台线程未启动，不再尝试
+        loans.historyComplete = true;
+    }
+}
+
+void ReaderLoansModel::loadActive(const QString& readerId)
+{
+    ReaderLoans& loans = cache[readerId];
+    loans.lastUsed = ++useCounter;
+    loans.activeTicket = DatabaseWorker::getInstance().submit(QString::fromUtf8(ActiveLoansSql),
+        QVariantList() << readerId, this,
+        [this, readerId](const QueryResult& result) {
+            onActiveReady(readerId, result);
+        });
+    if (loans.activeTicket == 0) {
+        cache.remove(readerId);
+        return;
+    }
+    evictReaders();
+}
+
+void ReaderLoansModel::onActiveReady(const QString& readerId, const QueryResult& result)
+{
+    auto it = cache.find(readerId);
+    if (it == cache.end() || it->activeTicket != result.ticket) {
+        return;
+    }
+    it->activeTicket = 0;
+
+    if (!result.success) {
+        qCWarning(lcModel) << "读取读者借阅失败:" << readerId << result.error;
+        cache.erase(it);
+        return;
+    }
+
+    bool showing = readerId == current;
+    if (showing) {
+        beginResetModel();
+    }
+    it->active.reserve(result.rows.size());
+    for (const QVariantList& row : result.rows) {
+        it->active.append(loanFromRow(row));
+    }
+    it->activeLoaded = true;
+    if (showing) {
+        endResetModel();
+        emit loaded(readerId);
+    }
+}
+
+void ReaderLoansModel::onHistoryReady(const QString& readerId, const QueryResult& result)
+{
+    auto it = cache.find(readerId);
+    if (it == cache.end() || it->historyTicket != result.ticket) {
+        return;
+    }
+    it->historyTicket = 0;
+
+    if (!result.success) {
+        qCWarning(lcModel) << "读取读者历史借阅失败:" << readerId << result.error;
+        it->historyComplete = true;
+        return;
+    }
+
+    if (result.rows.size() < HistoryPageSize) {
+        it->historyComplete = true;
+    }
+    if (result.rows.isEmpty()) {
+        return;
+    }
+
+    bool showing = readerId == current;
+    if (showing) {
+        int first = it->active.size() + it->history.size();
+        beginInsertRows(QModelIndex(), first, first + result.rows.size() - 1);
+    }
+    for (const QVariantList& row : result.rows) {
+        it->history.append(loanFromRow(row));
+    }
+    it->historyBound = it->history.last().id;
+    if (showing) {
+        endInsertRows();
+    }
+}
+
+void ReaderLoansModel::evictReaders()
+{
+    // 超出上限时淘汰最久未查看的读者（正在显示的除外）
+    while (cache.size() > MaxCachedReaders) {
+        auto oldest = cache.end();
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            if (it.key() != current && (oldest == cache.end() || it->lastUsed < oldest->lastUsed)) {
+                oldest = it;
+            }
+        }
+        if (oldest == cache.end()) {
+            break;
+        }
+        cache.erase(oldest);
+    }
+}
+
+const ReaderLoansModel::Loan* ReaderLoansModel::loanAt(int row) const
+{
+    auto it = cache.constFind(current);
+    if (it == cache.constEnd() || row < 0) {
+        return nullptr;
+    }
+    if (row < it->active.size()) {
+        return &it->active.at(row);
+    }
+    row -= it->active.size();
+    return row < it->history.size() ? &it->history.at(row) : nullptr;
+}
+
+ReaderLoansModel::Loan ReaderLoansModel::loanFromRow(const QVariantList& row)
+{
+    Loan loan;
+    loan.id = row.value(0).toInt();
+    loan.isbn = row.value(1).toString();
+    loan.title = row.value(2).toString();
+    loan.borrowDate = row.value(3).toString();
+    loan.dueDate = row.value(4).toString();
+    loan.returnDate = row.value(5).toString();
+    loan.status = row.value(6).toString();
+    loan.fine = row.value(7).toDouble();
+    if (loan.status == "借出") {
+        QDate dueDate = QDate::fromString(loan.dueDate, "yyyy-MM-dd");
+        if (dueDate.isValid()) {
+            loan.dueDay = dueDate.toJulianDay();
+        }
+    }
+    return loan;
+}
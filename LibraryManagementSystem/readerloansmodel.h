@@ -0,0 +1,100 @@
+#ifndef READERLOANSMODEL_H
+#define READERLOANSMODEL_H
+
+#include <QAbstractTableModel>
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <limits>
+
+struct QueryResult;
+
+// 单个读者的借阅情况：当前借出的记录全部读取，历史记录按借阅ID倒序分页读取（视图滚动到底部时继续读取）。
+// 查询按(reader_id, status)索引定位并关联books取书名，与借阅记录总数无关；
+// 最近查看的读者的结果保留在内存中，借书/还书后失效
+class ReaderLoansModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        IdColumn,
+        TitleColumn,
+        IsbnColumn,
+        BorrowDateColumn,
+        DueDateColumn,
+        ReturnDateColumn,
+        StatusColumn,
+        FineColumn,
+        ColumnCount
+    };
+
+    explicit ReaderLoansModel(QObject *parent = nullptr);
+
+    // 切换显示的读者，已缓存时不访问数据库；为空时清空
+    void setReader(const QString& readerId);
+    QString reader() const;
+
+    // 该读者的借阅有变化：丢弃缓存，正在显示时重新读取
+    void invalidate(const QString& readerId);
+    void clearCache();
+
+    // 当前读者借出中和其中已逾期的数量（当前借出的记录读取完成后有效）
+    int activeCount() const;
+    int overdueCount() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    // 每次读取的历史记录条数与最多缓存的读者数
+    static const int HistoryPageSize = 50;
+    static const int MaxCachedReaders = 32;
+
+signals:
+    // 读者当前借出的记录已读取
+    void loaded(const QString& readerId);
+
+private:
+
+    struct Loan {
+        int id = 0;
+        QString isbn;
+        QString title;
+        QString borrowDate;
+        QString dueDate;
+        QString returnDate;
+        QString status;
+        double fine = 0.0;
+        qint64 dueDay = std::numeric_limits<qint64>::max();  // 应还日期（儒略日）
+    };
+
+    struct ReaderLoans {
+        QVector<Loan> active;
+        QVector<Loan> history;
+        bool activeLoaded = false;
+        bool historyComplete = false;
+        qint64 historyBound = std::numeric_limits<qint64>::max();  // 已读取的最小借阅ID
+        int activeTicket = 0;
+        int historyTicket = 0;
+        quint64 lastUsed = 0;
+    };
+
+    void loadActive(const QString& readerId);
+    void onActiveReady(const QString& readerId, const QueryResult& result);
+    void onHistoryReady(const QString& readerId, const QueryResult& result);
+    void evictReaders();
+    const Loan* loanAt(int row) const;
+    static Loan loanFromRow(const QVariantList& row);
+
+    QHash<QString, ReaderLoans> cache;
+    QString current;
+    quint64 useCounter = 0;
+    qint64 today = 0;
+};
+
+#endif // READERLOANSMODEL_H
@@ -1,36 +1,28 @@
 #include "readermodel.h"
 #include <QSqlQuery>
 #include <QSqlError>
-#include <QDebug>
 #include <QDateTime>
+#include "databasemanager.h"
+#include "lookupcache.h"
+#include "borrowmodel.h"
+#include "queryprofiler.h"
 
 ReaderModel::ReaderModel(QObject *parent, QSqlDatabase db)
-    : QSqlTableModel(parent, db)
+    : PagedTableModel(parent, db)
 {
     setTable("readers");
-    setEditStrategy(QSqlTableModel::OnManualSubmit);
-    setHeaderData(0, Qt::Horizontal, "ID");
-    setHeaderData(1, Qt::Horizontal, "读者编号");
-    setHeaderData(2, Qt::Horizontal, "姓名");
-    setHeaderData(3, Qt::Horizontal, "性别");
-    setHeaderData(4, Qt::Horizontal, "电话");
-    setHeaderData(5, Qt::Horizontal, "邮箱");
-    setHeaderData(6, Qt::Horizontal, "地址");
-    setHeaderData(7, Qt::Horizontal, "注册日期");
-    setHeaderData(8, Qt::Horizontal, "状态");
-    // 检查是否有create_time字段，如果有则设置表头
-    QSqlQuery checkQuery(database());
-    if (checkQuery.exec("PRAGMA table_info(readers)")) {
-        int colIndex = 9;
-        while (checkQuery.next()) {
-            QString colName = checkQuery.value(1).toString().toLower();
-            if (colName == "create_time") {
-                setHeaderData(colIndex, Qt::Horizontal, "创建时间");
-                break;
-            }
-            colIndex++;
-        }
-    }
+    setHeaderData(fieldIndex("id"), Qt::Horizontal, "ID");
+    setHeaderData(fieldIndex("reader_id"), Qt::Horizontal, "读者编号");
+    setHeaderData(fieldIndex("name"), Qt::Horizontal, "姓名");
+    setHeaderData(fieldIndex("gender"), Qt::Horizontal, "性别");
+    setHeaderData(fieldIndex("phone"), Qt::Horizontal, "电话");
+    setHeaderData(fieldIndex("email"), Qt::Horizontal, "邮箱");
+    setHeaderData(fieldIndex("address"), Qt::Horizontal, "地址");
+    setHeaderData(fieldIndex("register_date"), Qt::Horizontal, "注册日期");
+    setHeaderData(fieldIndex("status"), Qt::Horizontal, "状态");
+    // 旧版数据库可能有create_time列（不存在时fieldIndex为-1，设置无效）
+    setHeaderData(fieldIndex("create_time"), Qt::Horizontal, "创建时间");
+    hasUpdateTime = fieldIndex("update_time") >= 0;
     select();
 }
 
@@ -43,79 +35,40 @@ QVariant ReaderModel::data(const QModelIndex &index, int role) const
         return Qt::AlignCenter;
     }
     
-    return QSqlTableModel::data(index, role);
-}
-
-bool ReaderModel::setData(const QModelIndex &index, const QVariant &value, int role)
-{
-    if (!index.isValid() || role != Qt::EditRole)
-        return false;
-    
-    return QSqlTableModel::setData(index, value, role);
-}
-
-Qt::ItemFlags ReaderModel::flags(const QModelIndex &index) const
-{
-    if (!index.isValid())
-        return Qt::NoItemFlags;
-    
-    return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable;
+    return PagedTableModel::data(index, role);
 }
 
 bool ReaderModel::addReader(const QString& readerId, const QString& name, const QString& gender,
                             const QString& phone, const QString& email, const QString& address)
 {
-    qDebug() << "=== 开始添加读者 ===";
-    qDebug() << "步骤1: 清理输入数据";
     QString cleanReaderId = readerId.trimmed();
     QString cleanName = name.trimmed();
-    qDebug() << "读者编号:" << cleanReaderId << "姓名:" << cleanName;
 
     // 检查读者编号是否为空
     if (cleanReaderId.isEmpty() || cleanName.isEmpty()) {
-        qDebug() << "添加读者失败: 读者编号和姓名不能为空";
+        qCWarning(lcModel) << "添加读者失败: 读者编号和姓名不能为空";
         return false;
     }
 
-    qDebug() << "步骤2: 检查读者编号是否已存在";
     if (readerExists(cleanReaderId)) {
-        qDebug() << "添加读者失败: 读者编号已存在:" << cleanReaderId;
+        qCWarning(lcModel) << "添加读者失败: 读者编号已存在:" << cleanReaderId;
         return false;
     }
-    qDebug() << "读者编号检查通过";
 
-    qDebug() << "步骤3: 准备SQL语句";
-    QSqlQuery query(database());
     // 获取当前时间作为注册日期
     QString currentTime = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
-    qDebug() << "当前时间(注册日期):" << currentTime;
 
     // 直接固定插入注册日期，不处理create_time
     QString sql = "INSERT INTO readers (reader_id, name, gender, phone, email, address, register_date) "
                   "VALUES (:reader_id, :name, :gender, :phone, :email, :address, :register_date)";
-    qDebug() << "SQL语句:" << sql;
-
-    qDebug() << "步骤4: 准备查询";
-    if (!query.prepare(sql)) {
-        qDebug() << "添加读者失败: prepare失败:" << query.lastError().text();
-        qDebug() << "错误代码:" << query.lastError().type();
-        qDebug() << "SQL:" << sql;
-
-        // 检查表结构
-        qDebug() << "步骤4.1: 检查表结构";
-        QSqlQuery checkQuery(database());
-        if (checkQuery.exec("PRAGMA table_info(readers)")) {
-            qDebug() << "表结构信息:";
-            while (checkQuery.next()) {
-                qDebug() << "  列名:" << checkQuery.value(1).toString()
-                    << "类型:" << checkQuery.value(2).toString();
-            }
-        }
+
+    bool prepared = false;
+    QSqlQuery query = DatabaseManager::getInstance().preparedQuery(sql, database(), &prepared);
+    if (!prepared) {
+        qCWarning(lcModel) << "添加读者失败: prepare失败:" << query.lastError().text();
         return false;
     }
-    qDebug() << "prepare成功";
 
-    qDebug() << "步骤5: 绑定参数值";
     query.bindValue(":reader_id", cleanReaderId);
     query.bindValue(":name", cleanName);
     query.bindValue(":gender", gender.trimmed());
@@ -123,42 +76,34 @@ bool ReaderModel::addReader(const QString& readerId, const QString& name, const
     query.bindValue(":email", email.trimmed());
     query.bindValue(":address", address.trimmed());
     query.bindValue(":register_date", currentTime); // 仅绑定注册日期
-    qDebug() << "参数绑定完成 - 注册日期:" << currentTime;
-
-    qDebug() << "步骤6: 执行SQL";
-    if (!query.exec()) {
-        QString errorMsg = query.lastError().text();
-        qDebug() << "添加读者失败: exec失败:" << errorMsg;
-        qDebug() << "错误代码:" << query.lastError().type();
-        qDebug() << "执行的SQL:" << query.lastQuery();
+
+    if (!DatabaseManager::getInstance().exec(query)) {
+        qCWarning(lcModel) << "添加读者失败:" << query.lastError().text();
         return false;
     }
-    qDebug() << "SQL执行成功";
+    qCDebug(lcModel) << "添加读者:" << cleanReaderId << cleanName;
+
+    LookupCache::getInstance().putReader(cleanReaderId, query.lastInsertId().toInt());
 
-    qDebug() << "步骤7: 刷新模型";
     select();
-    qDebug() << "=== 添加读者完成 ===";
     return true;
 }
 
 bool ReaderModel::updateReader(int id, const QString& readerId, const QString& name, const QString& gender,
                                const QString& phone, const QString& email, const QString& address)
 {
-    QSqlQuery query(database());
     // 获取当前时间作为更新时间
     QString updateTime = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
     
-    // 检查是否有update_time字段
-    QSqlQuery checkQuery(database());
-    bool hasUpdateTime = false;
-    if (checkQuery.exec("PRAGMA table_info(readers)")) {
-        while (checkQuery.next()) {
-            if (checkQuery.value(1).toString().toLower() == "update_time") {
-                hasUpdateTime = true;
-                break;
-            }
-        }
-    }
+    // 读者编号可能被修改，先取出旧编号以便更新内存索引
+    QSqlQuery oldQuery = DatabaseManager::getInstance().preparedQuery(
+        "SELECT reader_id FROM readers WHERE id=?", database());
+    oldQuery.addBindValue(id);
+    QString oldReaderId;
+    if (DatabaseManager::getInstance().exec(oldQuery) && oldQuery.next()) {
+        oldReaderId = oldQuery.value(0).toString();
+    }
+    oldQuery.finish();
     
     QString sql;
     if (hasUpdateTime) {
@@ -167,7 +112,7 @@ bool ReaderModel::updateReader(int id, const QString& readerId, const QString& n
         sql = "UPDATE readers SET reader_id=?, name=?, gender=?, phone=?, email=?, address=? WHERE id=?";
     }
     
-    query.prepare(sql);
+    QSqlQuery query = DatabaseManager::getInstance().preparedQuery(sql, database());
     query.addBindValue(readerId.trimmed());
     query.addBindValue(name.trimmed());
     query.addBindValue(gender.trimmed());
@@ -179,25 +124,62 @@ bool ReaderModel::updateReader(int id, const QString& readerId, const QString& n
     }
     query.addBindValue(id);
     
-    if (!query.exec()) {
-        qDebug() << "更新读者失败:" << query.lastError().text();
+    if (!DatabaseManager::getInstance().exec(query)) {
+        qCWarning(lcModel) << "更新读者失败:" << query.lastError().text();
         return false;
     }
     
+    if (query.numRowsAffected() > 0) {
+        if (!oldReaderId.isEmpty()) {
+            LookupCache::getInstance().removeReader(oldReaderId);
+        }
+        LookupCache::getInstance().putReader(readerId.trimmed(), id);
+    }
+    
     select();
     return true;
 }
 
 bool ReaderModel::deleteReader(int id)
 {
-    QSqlQuery query(database());
-    query.prepare("DELETE FROM readers WHERE id=?");
+    QSqlDatabase db = database();
+    DatabaseManager& manager = DatabaseManager::getInstance();
+    
+    // 删除读者与取消其预约在同一事务中完成，否则还回的书仍会留给已不存在的读者
+    QSqlQuery beginQuery = manager.preparedQuery("BEGIN IMMEDIATE", db);
+    if (!manager.exec(beginQuery)) {
+        qCWarning(lcModel) << "删除读者失败:" << beginQuery.lastError().text();
+        return false;
+    }
+    
+    QSqlQuery query = manager.preparedQuery("DELETE FROM readers WHERE id=? RETURNING reader_id", db);
     query.addBindValue(id);
     
-    if (!query.exec()) {
-        qDebug() << "删除读者失败:" << query.lastError().text();
+    if (!manager.exec(query)) {
+        qCWarning(lcModel) << "删除读者失败:" << query.lastError().text();
+        db.rollback();
+        return false;
+    }
+    QString readerId;
+    if (query.next()) {
+        readerId = query.value(0).toString();
+    }
+    query.finish();
+    
+    BorrowModel::HoldChanges holdChanges;
+    if (!readerId.isEmpty() && !BorrowModel::cancelReaderHolds(db, readerId, &holdChanges)) {
+        db.rollback();
         return false;
     }
+    if (!db.commit()) {
+        qCWarning(lcModel) << "删除读者失败:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    if (!readerId.isEmpty()) {
+        LookupCache::getInstance().removeReader(readerId);
+    }
+    BorrowModel::applyHoldChanges(holdChanges);
     
     select();
     return true;
@@ -229,12 +211,17 @@ void ReaderModel::filterReaders(const QString& readerId, const QString& name,
 
 bool ReaderModel::readerExists(const QString& readerId)
 {
-    QSqlQuery query(database());
-    query.prepare("SELECT COUNT(*) FROM readers WHERE reader_id=?");
+    // 内存索引已加载时直接给出答案
+    LookupCache::Answer cached = LookupCache::getInstance().findReader(readerId);
+    if (cached != LookupCache::Unknown) {
+        return cached == LookupCache::Found;
+    }
+    
+    QSqlQuery query = DatabaseManager::getInstance().preparedQuery(
+        "SELECT COUNT(*) FROM readers WHERE reader_id=?", database());
     query.addBindValue(readerId);
     
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt() > 0;
-    }
-    return false;
+    bool exists = DatabaseManager::getInstance().exec(query) && query.next() && query.value(0).toInt() > 0;
+    query.finish();
+    return exists;
 }
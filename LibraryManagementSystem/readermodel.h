@@ -1,18 +1,16 @@
 #ifndef READERMODEL_H
 #define READERMODEL_H
 
-#include <QSqlTableModel>
 #include <QSqlDatabase>
+#include "pagedtablemodel.h"
 
-class ReaderModel : public QSqlTableModel
+class ReaderModel : public PagedTableModel
 {
     Q_OBJECT
 
 public:
     explicit ReaderModel(QObject *parent = nullptr, QSqlDatabase db = QSqlDatabase());
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
-    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
-    Qt::ItemFlags flags(const QModelIndex &index) const override;
     
     // 添加读者
     bool addReader(const QString& readerId, const QString& name, const QString& gender,
@@ -31,6 +29,10 @@ public:
     
     // 检查读者是否存在
     bool readerExists(const QString& readerId);
+
+private:
+    // 旧版数据库的readers表可能有update_time列，构造时按表结构确定一次
+    bool hasUpdateTime = false;
 };
 
 #endif // READERMODEL_H
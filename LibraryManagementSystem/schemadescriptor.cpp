@@ -0,0 +1,56 @@
+#include "schemadescriptor.h"
+#include "queryprofiler.h"
+#include <QSqlQuery>
+#include <QSqlError>
+
+bool SchemaDescriptor::load(const QSqlDatabase& db)
+{
+    tables.clear();
+
+    // 一条语句读取所有普通表的列（表值函数pragma_table_info），按列序号排列；
+    // 跳过SQLite内部表、全文索引的虚拟表及其影子表（books_fts_data等是普通表，需按名称排除）
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT m.name, p.name, p.type FROM sqlite_master m, pragma_table_info(m.name) p "
+                    "WHERE m.type = 'table' AND m.name NOT LIKE 'sqlite_%' AND m.name NOT LIKE 'books_fts_%' "
+                    "AND m.sql NOT LIKE 'CREATE VIRTUAL%' "
+                    "ORDER BY m.name, p.cid")) {
+        qCWarning(lcModel) << "读取表结构失败:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        QString tableName = query.value(0).toString();
+        TableSchema& schema = tables[tableName];
+        schema.name = tableName;
+        schema.columns << query.value(1).toString();
+        schema.declaredTypes << query.value(2).toString();
+    }
+    return true;
+}
+
+void SchemaDescriptor::clear()
+{
+    tables.clear();
+}
+
+bool SchemaDescriptor::isLoaded() const
+{
+    return !tables.isEmpty();
+}
+
+TableSchema SchemaDescriptor::table(const QString& name) const
+{
+    return tables.value(name);
+}
+
+int SchemaDescriptor::column(const QString& table, const QString& field) const
+{
+    auto it = tables.constFind(table);
+    return it != tables.constEnd() ? it->column(field) : -1;
+}
+
+bool SchemaDescriptor::has(const QString& table, const QString& field) const
+{
+    auto it = tables.constFind(table);
+    return it != tables.constEnd() && it->has(field);
+}
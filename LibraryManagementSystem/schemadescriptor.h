@@ -0,0 +1,44 @@
+#ifndef SCHEMADESCRIPTOR_H
+#define SCHEMADESCRIPTOR_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+// 单个表的列：按表中的物理顺序排列，列号与SELECT *及分页模型的列号一致
+struct TableSchema
+{
+    QString name;
+    QStringList columns;
+    QStringList declaredTypes;
+
+    // 字段的列号，不存在时为-1
+    int column(const QString& field) const { return columns.indexOf(field); }
+
+    // 旧版数据库可能缺少或多出某些列（如readers.update_time），用它代替每次查询系统表
+    bool has(const QString& field) const { return columns.contains(field); }
+
+    bool isValid() const { return !columns.isEmpty(); }
+};
+
+// 数据库结构描述：迁移完成后一次性读取所有表的列，之后按字段名取列号和判断列是否存在，
+// 模型和视图不再执行PRAGMA table_info，也不再写死列号。
+// 加载后只读，可在任意线程中读取
+class SchemaDescriptor
+{
+public:
+    bool load(const QSqlDatabase& db);
+    void clear();
+    bool isLoaded() const;
+
+    // 表不存在时返回无效的TableSchema
+    TableSchema table(const QString& name) const;
+    int column(const QString& table, const QString& field) const;
+    bool has(const QString& table, const QString& field) const;
+
+private:
+    QHash<QString, TableSchema> tables;
+};
+
+#endif // SCHEMADESCRIPTOR_H
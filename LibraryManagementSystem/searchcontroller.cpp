@@ -0,0 +1,75 @@
+#include "searchcontroller.h"
+#include "pagedtablemodel.h"
+#include <QLineEdit>
+#include <utility>
+
+SearchController::SearchController(QLineEdit* edit, PagedTableModel* model, ApplyFunction apply,
+                                   QObject *parent)
+    : QObject(parent)
+    , edit(edit)
+    , model(model)
+    , apply(std::move(apply))
+{
+    timer.setSingleShot(true);
+    timer.setInterval(250);
+    connect(&timer, &QTimer::timeout, this, &SearchController::runSearch);
+
+    if (edit) {
+        connect(edit, &QLineEdit::textChanged, this, &SearchController::onTextChanged);
+        // 回车时不再等待，立即查询
+        connect(edit, &QLineEdit::returnPressed, this, &SearchController::runSearch);
+    }
+}
+
+void SearchController::setDelay(int ms)
+{
+    timer.setInterval(qMax(0, ms));
+}
+
+void SearchController::setNarrowingLimit(int rows)
+{
+    narrowingLimit = qMax(0, rows);
+}
+
+void SearchController::refresh()
+{
+    hasApplied = false;
+    runSearch();
+}
+
+void SearchController::onTextChanged()
+{
+    // 每次按键都重新计时，输入停顿后才查询
+    timer.start();
+}
+
+void SearchController::runSearch()
+{
+    timer.stop();
+    if (!model) {
+        return;
+    }
+
+    QString keyword = edit ? edit->text().trimmed() : QString();
+
+    // 模型在上一次查询之后没有被其他操作（增删改）刷新时，上一次的结果仍然有效
+    bool previousValid = hasApplied && model->selectGeneration() == appliedGeneration;
+    if (previousValid && keyword == appliedKeyword) {
+        return;
+    }
+
+    // 关键词按子串或前缀匹配，追加字符只会缩小结果；上一次结果已全部读取时直接在其中筛选，
+    // 上一次结果为空时不再查询
+    if (previousValid && !appliedKeyword.isEmpty() && keyword.startsWith(appliedKeyword)) {
+        QList<int> keys;
+        if (model->cachedKeys(&keys) && keys.size() <= narrowingLimit) {
+            model->restrictNextSelect(keys);
+        }
+    }
+
+    // select()会作废之前尚未完成的查询
+    apply(keyword);
+    appliedKeyword = keyword;
+    appliedGeneration = model->selectGeneration();
+    hasApplied = true;
+}
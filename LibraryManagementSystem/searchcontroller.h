@@ -0,0 +1,52 @@
+#ifndef SEARCHCONTROLLER_H
+#define SEARCHCONTROLLER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QString>
+#include <QPointer>
+#include <functional>
+
+class QLineEdit;
+class PagedTableModel;
+
+// 边输入边检索：合并连续的按键，输入停顿后才查询一次；
+// 新关键词只是在上一次关键词后追加字符时，在上一次的结果内筛选
+class SearchController : public QObject
+{
+    Q_OBJECT
+
+public:
+    // apply负责设置模型的筛选条件并调用一次select()
+    using ApplyFunction = std::function<void(const QString& keyword)>;
+
+    SearchController(QLineEdit* edit, PagedTableModel* model, ApplyFunction apply,
+                     QObject *parent = nullptr);
+
+    // 输入停顿多久后查询（毫秒）
+    void setDelay(int ms);
+
+    // 上一次结果不超过多少行时可以在其中筛选
+    void setNarrowingLimit(int rows);
+
+    // 其他筛选条件（如分类）变化后立即按当前关键词重新查询，不复用上一次的结果
+    void refresh();
+
+private slots:
+    void onTextChanged();
+    void runSearch();
+
+private:
+    QPointer<QLineEdit> edit;
+    QPointer<PagedTableModel> model;
+    ApplyFunction apply;
+    QTimer timer;
+    int narrowingLimit = 1000;
+
+    // 上一次查询的关键词及其对应的查询代数
+    QString appliedKeyword;
+    int appliedGeneration = -1;
+    bool hasApplied = false;
+};
+
+#endif // SEARCHCONTROLLER_H
@@ -0,0 +1,129 @@
+#include "sqliteprofile.h"
+#include "queryprofiler.h"
+#include <QCoreApplication>
+#include <QSettings>
+#include <QFileInfo>
+#include <QSqlQuery>
+#include <QSqlError>
+
+SqliteProfile SqliteProfile::load(const QStringList& arguments)
+{
+    SqliteProfile profile;
+
+    // 配置文件路径
+    QString configFile = QCoreApplication::applicationDirPath() + "/library.ini";
+    for (int i = 0; i < arguments.size(); i++) {
+        const QString& arg = arguments.at(i);
+        if (arg == "--config" && i + 1 < arguments.size()) {
+            configFile = arguments.at(i + 1);
+        } else if (arg.startsWith("--config=")) {
+            configFile = arg.mid(QString("--config=").length());
+        }
+    }
+
+    if (QFileInfo::exists(configFile)) {
+        QSettings settings(configFile, QSettings::IniFormat);
+        settings.beginGroup("sqlite");
+        const QStringList keys = settings.childKeys();
+        for (const QString& key : keys) {
+            if (!profile.set(key, settings.value(key).toString())) {
+                qCWarning(lcSql) << "忽略无效的SQLite配置:" << key << settings.value(key).toString();
+            }
+        }
+        settings.endGroup();
+    }
+
+    // 命令行参数覆盖配置文件
+    for (int i = 0; i < arguments.size(); i++) {
+        QString pair;
+        const QString& arg = arguments.at(i);
+        if (arg == "--pragma" && i + 1 < arguments.size()) {
+            pair = arguments.at(++i);
+        } else if (arg.startsWith("--pragma=")) {
+            pair = arg.mid(QString("--pragma=").length());
+        } else {
+            continue;
+        }
+
+        int separator = pair.indexOf('=');
+        if (separator <= 0 || !profile.set(pair.left(separator), pair.mid(separator + 1))) {
+            qCWarning(lcSql) << "忽略无效的SQLite参数:" << pair;
+        }
+    }
+
+    return profile;
+}
+
+bool SqliteProfile::set(const QString& key, const QString& value)
+{
+    QString name = key.trimmed().toLower();
+    QString text = value.trimmed().toUpper();
+    bool ok = false;
+
+    if (name == "journal_mode") {
+        static const QStringList modes = {"DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF"};
+        if (!modes.contains(text)) return false;
+        journalMode = text;
+    } else if (name == "synchronous") {
+        static const QStringList levels = {"OFF", "NORMAL", "FULL", "EXTRA"};
+        if (!levels.contains(text)) return false;
+        synchronous = text;
+    } else if (name == "cache_size") {
+        int kb = text.toInt(&ok);
+        if (!ok || kb < 0) return false;
+        cacheSizeKb = kb;
+    } else if (name == "mmap_size") {
+        qint64 bytes = text.toLongLong(&ok);
+        if (!ok || bytes < 0) return false;
+        mmapSize = bytes;
+    } else if (name == "temp_store") {
+        static const QStringList stores = {"DEFAULT", "FILE", "MEMORY"};
+        if (!stores.contains(text)) return false;
+        tempStore = text;
+    } else if (name == "busy_timeout") {
+        int ms = text.toInt(&ok);
+        if (!ok || ms < 0) return false;
+        busyTimeoutMs = ms;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool SqliteProfile::apply(const QSqlDatabase& db) const
+{
+    // 取值均已校验，可以直接拼接到PRAGMA语句中
+    QStringList pragmas;
+    pragmas << QString("PRAGMA busy_timeout = %1").arg(busyTimeoutMs)
+            << QString("PRAGMA journal_mode = %1").arg(journalMode)
+            << QString("PRAGMA synchronous = %1").arg(synchronous)
+            << QString("PRAGMA cache_size = -%1").arg(cacheSizeKb)
+            << QString("PRAGMA mmap_size = %1").arg(mmapSize)
+            << QString("PRAGMA temp_store = %1").arg(tempStore);
+
+    bool success = true;
+    QSqlQuery query(db);
+    for (const QString& pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            qCWarning(lcSql) << "应用SQLite参数失败:" << pragma << query.lastError().text();
+            success = false;
+        }
+        query.finish();
+    }
+    return success;
+}
+
+QString SqliteProfile::describe(const QSqlDatabase& db)
+{
+    static const QStringList names = {"journal_mode", "synchronous", "cache_size",
+                                      "mmap_size", "temp_store", "busy_timeout"};
+    QStringList values;
+    QSqlQuery query(db);
+    for (const QString& name : names) {
+        if (query.exec("PRAGMA " + name) && query.next()) {
+            values << QString("%1=%2").arg(name, query.value(0).toString());
+        }
+        query.finish();
+    }
+    return values.join(' ');
+}
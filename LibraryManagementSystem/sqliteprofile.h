@@ -0,0 +1,32 @@
+#ifndef SQLITEPROFILE_H
+#define SQLITEPROFILE_H
+
+#include <QString>
+#include <QStringList>
+#include <QSqlDatabase>
+
+// SQLite连接的性能参数，打开连接时通过PRAGMA应用
+struct SqliteProfile
+{
+    QString journalMode = "WAL";       // 日志模式：WAL下读不阻塞写
+    QString synchronous = "NORMAL";    // 同步级别：WAL + NORMAL在断电时只可能丢失最后的提交
+    int cacheSizeKb = 65536;           // 页缓存大小（KiB）
+    qint64 mmapSize = 268435456;       // 内存映射大小（字节），0表示关闭
+    QString tempStore = "MEMORY";      // 临时表与排序使用内存
+    int busyTimeoutMs = 5000;          // 遇到锁时的等待时间（毫秒）
+
+    // 依次读取配置文件[sqlite]分组和命令行参数（--pragma key=value），后者优先
+    // 配置文件由--config指定，默认为程序目录下的library.ini
+    static SqliteProfile load(const QStringList& arguments);
+
+    // 设置单个参数，名称与PRAGMA一致；值不合法时返回false并保持原值
+    bool set(const QString& key, const QString& value);
+
+    // 在连接上应用全部参数
+    bool apply(const QSqlDatabase& db) const;
+
+    // 从连接读取实际生效的参数值
+    static QString describe(const QSqlDatabase& db);
+};
+
+#endif // SQLITEPROFILE_H
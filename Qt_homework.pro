@@ -0,0 +1,8 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    app \
+    benchmarks
+
+app.subdir = LibraryManagementSystem
+benchmarks.subdir = LibraryManagementSystem/benchmarks